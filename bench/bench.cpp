@@ -0,0 +1,217 @@
+#include "bench.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#include "third_party/fmt/include/fmt/printf.h"
+
+namespace bench {
+struct Option {
+  std::string filter;
+  std::string out_path;
+  uint64_t min_time_ns = 200000000;
+  uint32_t repetition_num = 3;
+};
+
+struct Result {
+  std::string name;
+  uint32_t thread_num;
+  uint64_t iter_num;
+  std::vector<double> ns_per_op_vec;
+  double bytes_per_sec;
+};
+
+// run func on every thread with iter_num iterations each, the clock starts
+// once all threads are ready
+static uint64_t RunOnce(const Case &bench_case, uint64_t iter_num,
+                        uint64_t &byte_num) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint32_t ready_num = 0;
+  bool is_started = false;
+  std::vector<State> state_vec;
+  for (uint32_t i = 0; i < bench_case.thread_num; i++) {
+    state_vec.emplace_back(iter_num, i, bench_case.thread_num);
+  }
+
+  std::vector<std::thread> thread_vec;
+  for (uint32_t i = 0; i < bench_case.thread_num; i++) {
+    thread_vec.emplace_back([&, i] {
+      {
+        std::unique_lock<std::mutex> ul(mutex);
+        ready_num++;
+        cv.notify_all();
+        cv.wait(ul, [&] { return is_started; });
+      }
+      bench_case.func(state_vec[i]);
+    });
+  }
+
+  std::unique_lock<std::mutex> ul(mutex);
+  cv.wait(ul, [&] { return ready_num == bench_case.thread_num; });
+  auto begin = std::chrono::steady_clock::now();
+  is_started = true;
+  cv.notify_all();
+  ul.unlock();
+  for (std::thread &t : thread_vec) t.join();
+  auto end = std::chrono::steady_clock::now();
+
+  byte_num = 0;
+  for (const State &state : state_vec) byte_num += state.GetByteNum();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+      .count();
+}
+
+static Result Run(const Case &bench_case, const Option &option) {
+  uint64_t iter_num = 1;
+  uint64_t elapsed_ns = 0;
+  uint64_t byte_num = 0;
+  while (true) {
+    elapsed_ns = RunOnce(bench_case, iter_num, byte_num);
+    if (elapsed_ns >= option.min_time_ns || iter_num >= (1UL << 40)) break;
+    // aim a bit past the minimum time so the next run is usually the last
+    double scale = elapsed_ns == 0
+                       ? 100.0
+                       : 1.4 * option.min_time_ns / static_cast<double>(elapsed_ns);
+    iter_num = std::max<uint64_t>(iter_num + 1, iter_num * std::min(scale, 100.0));
+  }
+
+  Result result;
+  result.name = bench_case.name;
+  result.thread_num = bench_case.thread_num;
+  result.iter_num = iter_num;
+  double best_ns = 0;
+  for (uint32_t i = 0; i < option.repetition_num; i++) {
+    if (i > 0) elapsed_ns = RunOnce(bench_case, iter_num, byte_num);
+    // every thread runs iter_num operations
+    double ns_per_op = static_cast<double>(elapsed_ns) /
+                       (static_cast<double>(iter_num) * bench_case.thread_num);
+    result.ns_per_op_vec.push_back(ns_per_op);
+    if (i == 0 || elapsed_ns < best_ns) {
+      best_ns = elapsed_ns;
+      result.bytes_per_sec = byte_num * 1e9 / elapsed_ns;
+    }
+  }
+  return result;
+}
+
+static std::string EscapeJson(const std::string &str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+static std::string ToJson(const std::vector<Result> &result_vec) {
+  char host[256] = {0};
+  gethostname(host, sizeof(host) - 1);
+#ifdef NDEBUG
+  const char *build_type = "release";
+#else
+  const char *build_type = "debug";
+#endif
+
+  std::string json = "{\n  \"context\": {\n";
+  json += fmt::sprintf("    \"timestamp\": %ld,\n", time(nullptr));
+  json += fmt::sprintf("    \"host\": \"%s\",\n", EscapeJson(host));
+  json += fmt::sprintf("    \"cpu_num\": %u,\n",
+                       std::thread::hardware_concurrency());
+  json += fmt::sprintf("    \"build_type\": \"%s\"\n", build_type);
+  json += "  },\n  \"benchmarks\": [";
+  for (size_t i = 0; i < result_vec.size(); i++) {
+    const Result &result = result_vec[i];
+    std::vector<double> sorted_vec = result.ns_per_op_vec;
+    std::sort(sorted_vec.begin(), sorted_vec.end());
+    double min_ns = sorted_vec.front();
+    double median_ns = sorted_vec[sorted_vec.size() / 2];
+    json += i == 0 ? "\n" : ",\n";
+    json += "    {";
+    json += fmt::sprintf("\"name\": \"%s\", ", EscapeJson(result.name));
+    json += fmt::sprintf("\"threads\": %u, ", result.thread_num);
+    json += fmt::sprintf("\"iterations\": %lu, ", result.iter_num);
+    json += fmt::sprintf("\"repetitions\": %zu, ", sorted_vec.size());
+    json += fmt::sprintf("\"ns_per_op\": %.3f, ", min_ns);
+    json += fmt::sprintf("\"median_ns_per_op\": %.3f, ", median_ns);
+    json += fmt::sprintf("\"max_ns_per_op\": %.3f, ", sorted_vec.back());
+    json += fmt::sprintf("\"ops_per_sec\": %.1f, ", 1e9 / min_ns);
+    json += fmt::sprintf("\"bytes_per_sec\": %.1f}", result.bytes_per_sec);
+  }
+  json += "\n  ]\n}\n";
+  return json;
+}
+
+static void PrintUsage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [--filter=substr] [--min_time_ms=200] "
+          "[--repetitions=3] [--out=path]\n",
+          name);
+}
+
+static bool ParseOption(int argc, char *argv[], Option &option) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value_of = [&](const char *key) -> const char * {
+      size_t key_len = strlen(key);
+      if (arg.compare(0, key_len, key) != 0) return nullptr;
+      return argv[i] + key_len;
+    };
+    const char *value = nullptr;
+    if ((value = value_of("--filter=")) != nullptr) {
+      option.filter = value;
+    } else if ((value = value_of("--min_time_ms=")) != nullptr) {
+      option.min_time_ns = strtoull(value, nullptr, 10) * 1000000;
+    } else if ((value = value_of("--repetitions=")) != nullptr) {
+      option.repetition_num = std::max(1UL, strtoul(value, nullptr, 10));
+    } else if ((value = value_of("--out=")) != nullptr) {
+      option.out_path = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace bench
+
+int main(int argc, char *argv[]) {
+  bench::Option option;
+  if (!bench::ParseOption(argc, argv, option)) {
+    bench::PrintUsage(argv[0]);
+    return -1;
+  }
+
+  std::vector<bench::Result> result_vec;
+  for (const bench::Case &bench_case :
+       bench::Registry::GetInstance()->GetCaseVec()) {
+    if (bench_case.name.find(option.filter) == std::string::npos) continue;
+    bench::Result result = bench::Run(bench_case, option);
+    fprintf(stderr, "%-48s %12.2f ns/op\n", result.name.c_str(),
+            *std::min_element(result.ns_per_op_vec.begin(),
+                              result.ns_per_op_vec.end()));
+    result_vec.push_back(std::move(result));
+  }
+
+  std::string json = bench::ToJson(result_vec);
+  if (option.out_path.empty()) {
+    fputs(json.c_str(), stdout);
+    return 0;
+  }
+  FILE *file = fopen(option.out_path.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "open %s error %s\n", option.out_path.c_str(),
+            strerror(errno));
+    return -1;
+  }
+  fputs(json.c_str(), file);
+  fclose(file);
+  return 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// minimal benchmark harness, every case runs its loop body
+// state.GetIterNum() times, the harness grows the iteration number until a
+// run lasts at least the minimum time and reports the fastest repetition
+#define WEBKIT_BENCH(NAME, FUNC) WEBKIT_BENCH_THREADS(NAME, FUNC, 1)
+
+#define WEBKIT_BENCH_THREADS(NAME, FUNC, THREAD_NUM)                     \
+  static const bool WEBKIT_BENCH_CONCAT(kBenchRegistered, __LINE__) =   \
+      bench::Registry::GetInstance()->Add((NAME), (FUNC), (THREAD_NUM))
+
+#define WEBKIT_BENCH_CONCAT(A, B) WEBKIT_BENCH_CONCAT_IMPL(A, B)
+#define WEBKIT_BENCH_CONCAT_IMPL(A, B) A##B
+
+namespace bench {
+class State {
+ public:
+  State(uint64_t iter_num, uint32_t thread_idx, uint32_t thread_num)
+      : iter_num_(iter_num),
+        thread_idx_(thread_idx),
+        thread_num_(thread_num),
+        byte_num_(0) {}
+
+  uint64_t GetIterNum() const { return iter_num_; }
+
+  uint32_t GetThreadIdx() const { return thread_idx_; }
+
+  uint32_t GetThreadNum() const { return thread_num_; }
+
+  // bytes processed by this thread, reported as bytes_per_sec
+  void SetByteNum(uint64_t byte_num) { byte_num_ = byte_num; }
+
+  uint64_t GetByteNum() const { return byte_num_; }
+
+ private:
+  uint64_t iter_num_;
+  uint32_t thread_idx_;
+  uint32_t thread_num_;
+  uint64_t byte_num_;
+};
+
+using FuncType = std::function<void(State &)>;
+
+struct Case {
+  std::string name;
+  FuncType func;
+  uint32_t thread_num;
+};
+
+class Registry {
+ private:
+  Registry() = default;
+
+ public:
+  static Registry *GetInstance() {
+    static Registry instance;
+    return &instance;
+  }
+
+  bool Add(const std::string &name, FuncType func, uint32_t thread_num) {
+    case_vec_.push_back(Case{name, std::move(func), thread_num});
+    return true;
+  }
+
+  const std::vector<Case> &GetCaseVec() const { return case_vec_; }
+
+ private:
+  std::vector<Case> case_vec_;
+};
+
+template <typename T>
+inline void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+}  // namespace bench
@@ -0,0 +1,57 @@
+#include <memory>
+#include <string>
+
+#include "bench.h"
+#include "channel/inproc_channel.h"
+#include "dispatcher/string_dispatcher.h"
+#include "dispatcher/string_serialization.h"
+#include "packet/byte_packet.h"
+#include "pool/thread_pool.h"
+
+class EchoDispatcher : public webkit::StringDispatcher {
+ public:
+  webkit::Status Forward(uint32_t /*method_id*/, const std::string &req,
+                         std::string &rsp) override {
+    rsp = req;
+    return webkit::Status::OK();
+  }
+
+  bool HasMethod(uint32_t /*method_id*/) const override { return true; }
+};
+
+class EchoDispatcherFactory : public webkit::DispatcherFactory {
+ public:
+  std::shared_ptr<webkit::Dispatcher> Build() override {
+    return std::make_shared<EchoDispatcher>();
+  }
+};
+
+// a request through the dispatcher and back without the kernel, what is
+// left is framework overhead, serialization, dispatch and metrics
+static void InProcRoundTrip(bench::State &state, bool is_pool) {
+  static webkit::ServerConfig server_config;
+  static webkit::BytePacketFactory packet_factory(&server_config);
+  static EchoDispatcherFactory dispatcher_factory;
+  webkit::PacketFactory::SetDefaultInstance(&packet_factory);
+  webkit::DispatcherFactory::SetDefaultInstance(&dispatcher_factory);
+
+  webkit::ThreadPool pool(1, 1024);
+  pool.Run();
+  webkit::ClientConfig client_config;
+  webkit::InProcChannel channel(&client_config, is_pool ? &pool : nullptr);
+  std::string req(64, 'x');
+  std::string rsp;
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    webkit::StringSerializer serializer(1, req);
+    channel.Write(serializer);
+    webkit::StringParser parser(rsp);
+    channel.Read(parser);
+  }
+  bench::DoNotOptimize(rsp.data());
+  pool.Stop();
+}
+
+WEBKIT_BENCH("channel/inproc/direct",
+             [](bench::State &state) { InProcRoundTrip(state, false); });
+WEBKIT_BENCH("channel/inproc/pool",
+             [](bench::State &state) { InProcRoundTrip(state, true); });
@@ -0,0 +1,67 @@
+#include <vector>
+
+#include "bench.h"
+#include "channel/simple_adapter.h"
+#include "packet/byte_packet.h"
+
+static constexpr size_t kPacketCapacity = 64UL << 20;
+
+// write and read the same amount each round so the data region keeps
+// wrapping around the end of the buffer
+static void PacketWriteReadWrap(bench::State &state, size_t size) {
+  webkit::BytePacketBuf buf(kPacketCapacity);
+  std::vector<char> data(size, 'x');
+  size_t write_size = 0;
+  size_t read_size = 0;
+  // a fixed offset keeps every round from starting at the buffer begin
+  buf.Write(data.data(), size / 2 + 1, write_size);
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    buf.Write(data.data(), size, write_size);
+    buf.Read(data.data(), size, read_size);
+  }
+  bench::DoNotOptimize(data.data());
+  state.SetByteNum(state.GetIterNum() * size);
+}
+
+// grow an empty buffer to 64KB in 1KB writes
+static void PacketExpand(bench::State &state) {
+  static constexpr size_t kChunkSize = 1024;
+  static constexpr size_t kTotalSize = 64 * 1024;
+  std::vector<char> data(kChunkSize, 'x');
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    webkit::BytePacketBuf buf(kPacketCapacity);
+    size_t write_size = 0;
+    for (size_t size = 0; size < kTotalSize; size += kChunkSize) {
+      buf.Write(data.data(), kChunkSize, write_size);
+    }
+    bench::DoNotOptimize(buf.GetDataSize());
+  }
+  state.SetByteNum(state.GetIterNum() * kTotalSize);
+}
+
+// frame a body from one packet into another and unframe it back
+static void AdapterFraming(bench::State &state, size_t size) {
+  webkit::BytePacket src(kPacketCapacity);
+  webkit::BytePacket wire(kPacketCapacity);
+  webkit::BytePacket dst(kPacketCapacity);
+  std::vector<char> data(size, 'x');
+  size_t write_size = 0;
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    src.Write(data.data(), size, write_size);
+    webkit::SimpleAdapter(src, wire, size).AdaptTo();
+    webkit::SimpleAdapter(dst, wire, 0).AdaptFrom();
+    dst.Clear();
+  }
+  bench::DoNotOptimize(dst.GetDataSize());
+  state.SetByteNum(state.GetIterNum() * size);
+}
+
+WEBKIT_BENCH("byte_packet_buf/write_read_wrap/64",
+             [](bench::State &state) { PacketWriteReadWrap(state, 64); });
+WEBKIT_BENCH("byte_packet_buf/write_read_wrap/4096",
+             [](bench::State &state) { PacketWriteReadWrap(state, 4096); });
+WEBKIT_BENCH("byte_packet_buf/expand/65536", PacketExpand);
+WEBKIT_BENCH("simple_adapter/framing/64",
+             [](bench::State &state) { AdapterFraming(state, 64); });
+WEBKIT_BENCH("simple_adapter/framing/4096",
+             [](bench::State &state) { AdapterFraming(state, 4096); });
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "pool/thread_pool.h"
+
+static constexpr uint32_t kPoolThreadNum = 2;
+static constexpr size_t kPoolCapacity = 4096;
+static constexpr size_t kBatchSize = 32;
+
+// a capture the size of a server dispatch task, four pointers
+struct Capture {
+  void *server;
+  void *event;
+  void *limiter;
+  uint64_t admit_tick;
+};
+
+static void FunctionMove(bench::State &state) {
+  Capture capture{nullptr, nullptr, nullptr, 0};
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    capture.admit_tick = i;
+    std::function<void()> func = [capture] { bench::DoNotOptimize(capture); };
+    std::function<void()> moved = std::move(func);
+    bench::DoNotOptimize(moved);
+  }
+}
+
+static void TaskMove(bench::State &state) {
+  Capture capture{nullptr, nullptr, nullptr, 0};
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    capture.admit_tick = i;
+    webkit::Task task = [capture] { bench::DoNotOptimize(capture); };
+    webkit::Task moved = std::move(task);
+    bench::DoNotOptimize(moved);
+  }
+}
+
+static void WaitDone(const std::atomic<uint64_t> &done_num, uint64_t num) {
+  while (done_num.load(std::memory_order_acquire) < num) {
+    std::this_thread::yield();
+  }
+}
+
+// one TrySubmit and one worker wakeup per task
+static void PoolSubmit(bench::State &state) {
+  webkit::ThreadPool pool(kPoolThreadNum, kPoolCapacity);
+  pool.Run();
+  std::atomic<uint64_t> done_num{0};
+  auto func = [&done_num] {
+    done_num.fetch_add(1, std::memory_order_release);
+  };
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    // a refused task is consumed, so every attempt builds a new one
+    while (!pool.TrySubmit(0, func).Ok()) {
+      std::this_thread::yield();
+    }
+  }
+  WaitDone(done_num, state.GetIterNum());
+  pool.Stop();
+}
+
+// keyed over a few connections, each key wakes only its own worker
+static void PoolSubmitKeyed(bench::State &state) {
+  webkit::ThreadPool pool(kPoolThreadNum, kPoolCapacity);
+  pool.Run();
+  std::atomic<uint64_t> done_num{0};
+  auto func = [&done_num] {
+    done_num.fetch_add(1, std::memory_order_release);
+  };
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    while (!pool.Submit(i % 16, func).Ok()) {
+      std::this_thread::yield();
+    }
+  }
+  WaitDone(done_num, state.GetIterNum());
+  pool.Stop();
+}
+
+// kBatchSize tasks per SubmitN and one wakeup per batch
+static void PoolSubmitN(bench::State &state) {
+  webkit::ThreadPool pool(kPoolThreadNum, kPoolCapacity);
+  pool.Run();
+  std::atomic<uint64_t> done_num{0};
+  std::vector<webkit::Task> task_vec;
+  for (uint64_t i = 0; i < state.GetIterNum(); i += kBatchSize) {
+    size_t batch_size = std::min<uint64_t>(kBatchSize, state.GetIterNum() - i);
+    task_vec.clear();
+    for (size_t j = 0; j < batch_size; j++) {
+      task_vec.emplace_back([&done_num] {
+        done_num.fetch_add(1, std::memory_order_release);
+      });
+    }
+    size_t offset = 0;
+    while (offset < batch_size) {
+      size_t submit_num = 0;
+      pool.SubmitN(0, task_vec.data() + offset, batch_size - offset,
+                   submit_num);
+      offset += submit_num;
+      if (offset < batch_size) std::this_thread::yield();
+    }
+  }
+  WaitDone(done_num, state.GetIterNum());
+  pool.Stop();
+}
+
+WEBKIT_BENCH("task/move/std_function", FunctionMove);
+WEBKIT_BENCH("task/move/task", TaskMove);
+WEBKIT_BENCH("thread_pool/submit", PoolSubmit);
+WEBKIT_BENCH("thread_pool/submit_keyed", PoolSubmitKeyed);
+WEBKIT_BENCH("thread_pool/submit_n/32", PoolSubmitN);
@@ -0,0 +1,50 @@
+#include <thread>
+
+#include "bench.h"
+#include "util/circular_queue.h"
+
+static constexpr size_t kQueueCapacity = 1024;
+
+// every thread pushes one value and pops one value, all threads share a
+// single queue so head and tail are contended
+static void QueuePushPop(bench::State &state) {
+  static webkit::CircularQueue<uint64_t> queue(kQueueCapacity);
+  uint64_t value = state.GetThreadIdx();
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    while (!queue.Push(value).Ok()) {
+      std::this_thread::yield();
+    }
+    while (!queue.Pop(value).Ok()) {
+      std::this_thread::yield();
+    }
+  }
+  bench::DoNotOptimize(value);
+}
+
+// half of the threads produce and the other half consume
+static void QueueProducerConsumer(bench::State &state) {
+  static webkit::CircularQueue<uint64_t> queue(kQueueCapacity);
+  bool is_producer = state.GetThreadIdx() % 2 == 0;
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    if (is_producer) {
+      while (!queue.Push(i).Ok()) {
+        std::this_thread::yield();
+      }
+    } else {
+      while (!queue.Pop(value).Ok()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  bench::DoNotOptimize(value);
+}
+
+WEBKIT_BENCH_THREADS("circular_queue/push_pop/threads:1", QueuePushPop, 1);
+WEBKIT_BENCH_THREADS("circular_queue/push_pop/threads:2", QueuePushPop, 2);
+WEBKIT_BENCH_THREADS("circular_queue/push_pop/threads:4", QueuePushPop, 4);
+WEBKIT_BENCH_THREADS("circular_queue/push_pop/threads:8", QueuePushPop, 8);
+WEBKIT_BENCH_THREADS("circular_queue/producer_consumer/threads:2",
+                     QueueProducerConsumer, 2);
+WEBKIT_BENCH_THREADS("circular_queue/producer_consumer/threads:4",
+                     QueueProducerConsumer, 4);
@@ -0,0 +1,24 @@
+#include <string>
+
+#include "bench.h"
+#include "dispatcher/string_serialization.h"
+#include "packet/byte_packet.h"
+
+static void StringRoundTrip(bench::State &state, size_t size) {
+  webkit::BytePacket packet(64UL << 20);
+  std::string req(size, 'x');
+  std::string rsp;
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    webkit::StringSerializer serializer(1, req);
+    serializer.SerializeTo(packet);
+    webkit::StringParser parser(rsp);
+    parser.ParseFrom(packet);
+  }
+  bench::DoNotOptimize(rsp.data());
+  state.SetByteNum(state.GetIterNum() * size);
+}
+
+WEBKIT_BENCH("string_serialization/round_trip/64",
+             [](bench::State &state) { StringRoundTrip(state, 64); });
+WEBKIT_BENCH("string_serialization/round_trip/4096",
+             [](bench::State &state) { StringRoundTrip(state, 4096); });
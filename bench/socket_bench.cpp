@@ -0,0 +1,71 @@
+#include <cstdint>
+#include <thread>
+
+#include "bench.h"
+#include "socket/tcp_socket.h"
+
+static constexpr size_t kHeaderSize = 8;
+static constexpr size_t kBodySize = 64;
+
+// a message leaves as header then body in two writes, like a packet written
+// by the protocol adapter
+static bool WriteMessage(webkit::TcpSocket &socket, const uint8_t *data) {
+  size_t write_size = 0;
+  socket.Cork(true);
+  bool is_ok = socket.Write(data, kHeaderSize, write_size).Ok() &&
+               socket.Write(data + kHeaderSize, kBodySize, write_size).Ok();
+  socket.Cork(false);
+  return is_ok;
+}
+
+static bool ReadMessage(webkit::TcpSocket &socket, uint8_t *data) {
+  size_t read_size = 0;
+  return socket.Read(data, kHeaderSize + kBodySize, read_size).Ok();
+}
+
+// request/response over loopback tcp with the given option on both ends,
+// without TCP_NODELAY the body waits on the peer's delayed ack every call
+static void TcpRoundTrip(bench::State &state, uint16_t port,
+                         const webkit::SocketOption &option) {
+  webkit::TcpSocket listen_socket;
+  if (!listen_socket.Listen("127.0.0.1", port, option).Ok()) return;
+
+  std::thread echo_thread([&] {
+    webkit::TcpSocket socket;
+    if (!listen_socket.Accept(&socket).Ok()) return;
+    if (!socket.SetOption(option).Ok()) return;
+    uint8_t data[kHeaderSize + kBodySize];
+    for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+      if (!ReadMessage(socket, data) || !WriteMessage(socket, data)) return;
+    }
+  });
+
+  webkit::TcpSocket socket;
+  if (socket.Connect("127.0.0.1", port, option).Ok()) {
+    uint8_t data[kHeaderSize + kBodySize] = {0};
+    for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+      if (!WriteMessage(socket, data) || !ReadMessage(socket, data)) break;
+    }
+    bench::DoNotOptimize(data);
+    socket.Close();
+  }
+  echo_thread.join();
+  listen_socket.Close();
+}
+
+static webkit::SocketOption MakeOption(bool is_nodelay, bool is_cork) {
+  webkit::SocketOption option;
+  option.is_nodelay = is_nodelay;
+  option.is_cork = is_cork;
+  return option;
+}
+
+WEBKIT_BENCH("socket/tcp/nagle", [](bench::State &state) {
+  TcpRoundTrip(state, 19631, MakeOption(false, false));
+});
+WEBKIT_BENCH("socket/tcp/nodelay", [](bench::State &state) {
+  TcpRoundTrip(state, 19632, MakeOption(true, false));
+});
+WEBKIT_BENCH("socket/tcp/nodelay_cork", [](bench::State &state) {
+  TcpRoundTrip(state, 19633, MakeOption(true, true));
+});
@@ -0,0 +1,76 @@
+#include <unistd.h>
+
+#include "bench.h"
+#include "logger/callback_logger.h"
+#include "util/generator.h"
+#include "webkit/logger.h"
+
+static void UidGenerate(bench::State &state) {
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    uint64_t uid = webkit::UidGenerator::GetInstance()->Generate();
+    bench::DoNotOptimize(uid);
+  }
+}
+
+static void UidGenerateHex(bench::State &state) {
+  char buf[webkit::UidGenerator::kHexSize];
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    uint64_t uid = webkit::UidGenerator::GetInstance()->Generate();
+    webkit::UidGenerator::ToHex(uid, buf, sizeof(buf));
+    bench::DoNotOptimize(buf);
+  }
+}
+
+// formats the full line with the default prefix and drops it, measures the
+// cost paid on the calling thread without any io
+class NullLogger : public webkit::CallbackLogger {
+ public:
+  void Log(Level /*level*/, const std::string &message) override {
+    bench::DoNotOptimize(message.data());
+  }
+};
+
+#ifdef WEBKIT_BINARY_LOG
+class NullBinaryLogger : public webkit::BinaryLogger {
+ public:
+  void Write(const void *record, size_t /*size*/) override {
+    bench::DoNotOptimize(record);
+  }
+};
+#endif
+
+// info is enabled and debug is filtered out
+static void LogBench(bench::State &state, bool is_enable) {
+  static NullLogger logger;
+  logger.SetLevel(webkit::Logger::eInfo);
+  webkit::Logger *old_logger = webkit::Logger::GetDefaultInstance();
+  webkit::Logger::SetDefaultInstance(&logger);
+#ifdef WEBKIT_BINARY_LOG
+  static NullBinaryLogger binary_logger;
+  binary_logger.SetLevel(webkit::Logger::eInfo);
+  webkit::BinaryLogger *old_binary_logger =
+      webkit::BinaryLogger::GetDefaultInstance();
+  webkit::BinaryLogger::SetDefaultInstance(&binary_logger);
+#endif
+
+  for (uint64_t i = 0; i < state.GetIterNum(); i++) {
+    if (is_enable) {
+      WEBKIT_LOGINFO("bench log %lu %s", i, "value");
+    } else {
+      WEBKIT_LOGDEBUG("bench log %lu %s", i, "value");
+    }
+  }
+
+  webkit::Logger::SetDefaultInstance(old_logger);
+#ifdef WEBKIT_BINARY_LOG
+  webkit::BinaryLogger::SetDefaultInstance(old_binary_logger);
+#endif
+}
+
+WEBKIT_BENCH("uid_generator/generate", UidGenerate);
+WEBKIT_BENCH_THREADS("uid_generator/generate/threads:4", UidGenerate, 4);
+WEBKIT_BENCH("uid_generator/generate_hex", UidGenerateHex);
+WEBKIT_BENCH("webkit_log/enabled",
+             [](bench::State &state) { LogBench(state, true); });
+WEBKIT_BENCH("webkit_log/disabled",
+             [](bench::State &state) { LogBench(state, false); });
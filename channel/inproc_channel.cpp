@@ -0,0 +1,126 @@
+#include "inproc_channel.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "util/coarse_clock.h"
+#include "util/trace_helper.h"
+#include "webkit/dispatcher.h"
+#include "webkit/logger.h"
+
+namespace webkit {
+// shared with the worker, which may outlive a Read that timed out
+struct InProcChannel::Call {
+  std::shared_ptr<Packet> packet_sp;
+  Status status;
+  bool is_done = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+InProcChannel::InProcChannel(const ClientConfig *config, Pool *pool)
+    : config_(config),
+      pool_(pool),
+      packet_sp_(nullptr),
+      deadline_ms_(0),
+      is_dispatched_(false) {
+  packet_sp_ = PacketFactory::GetDefaultInstance()->Build();
+}
+
+void InProcChannel::SetDeadlineMs(uint64_t deadline_ms) {
+  deadline_ms_ = deadline_ms;
+}
+
+void InProcChannel::SetTimeoutMs(uint32_t timeout_ms) {
+  deadline_ms_ =
+      timeout_ms == 0 ? 0 : CoarseClock::GetInstance()->NowMs() + timeout_ms;
+}
+
+Status InProcChannel::Write(Serializer &serializer) {
+  TraceHelper *trace_helper = TraceHelper::GetInstance();
+  uint64_t inherit_deadline_ms = trace_helper->GetDeadlineMs();
+  if (deadline_ms_ != 0 &&
+      (inherit_deadline_ms == 0 || deadline_ms_ < inherit_deadline_ms)) {
+    trace_helper->SetDeadlineMs(deadline_ms_);
+  }
+  Status s = serializer.SerializeTo(*packet_sp_);
+  trace_helper->SetDeadlineMs(inherit_deadline_ms);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("serialize to error code %d message %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelWriteError, "channel write error");
+  }
+  is_dispatched_ = false;
+  return Status::OK();
+}
+
+Status InProcChannel::Read(Parser &parser) {
+  if (!is_dispatched_) {
+    Status s = Dispatch();
+    if (!s.Ok()) return s;
+    is_dispatched_ = true;
+  }
+  Status s = parser.ParseFrom(*packet_sp_);
+  if (s.Code() == StatusCode::eRetry) return s;
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("packet parse from error code %d message %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelReadError, "channel read error");
+  }
+  return Status::OK();
+}
+
+Status InProcChannel::Dispatch() {
+  Status s;
+  if (pool_ == nullptr) {
+    // the dispatcher takes over the trace state of the thread it runs on,
+    // here that of the caller, which is put back afterwards
+    TraceHelper *trace_helper = TraceHelper::GetInstance();
+    TraceContext context = trace_helper->GetContext();
+    uint64_t deadline_ms = trace_helper->GetDeadlineMs();
+    uint64_t recv_ms = trace_helper->GetRecvMs();
+    // the request is received now, not with the one the caller serves
+    trace_helper->SetRecvMs(0);
+    s = DispatcherFactory::GetDefaultInstance()->Build()->Dispatch(
+        packet_sp_.get());
+    trace_helper->SetContext(context);
+    trace_helper->SetDeadlineMs(deadline_ms);
+    trace_helper->SetRecvMs(recv_ms);
+  } else {
+    auto call_sp = std::make_shared<Call>();
+    call_sp->packet_sp = packet_sp_;
+    s = pool_->TrySubmit([call_sp] {
+      Status dispatch_status =
+          DispatcherFactory::GetDefaultInstance()->Build()->Dispatch(
+              call_sp->packet_sp.get());
+      std::lock_guard<std::mutex> lg(call_sp->mutex);
+      call_sp->status = dispatch_status;
+      call_sp->is_done = true;
+      call_sp->cv.notify_one();
+    });
+    if (!s.Ok()) {
+      WEBKIT_LOGERROR("worker pool submit error status code %d message %s",
+                      s.Code(), s.Message());
+      return Status::Error(StatusCode::eChannelWriteError,
+                           "channel write error");
+    }
+    std::unique_lock<std::mutex> ul(call_sp->mutex);
+    auto timeout = std::chrono::seconds(config_->GetSockTimeoutSec()) +
+                   std::chrono::microseconds(config_->GetSockTimeoutUsec());
+    if (!call_sp->cv.wait_for(ul, timeout, [&] { return call_sp->is_done; })) {
+      // the worker still holds the packet, the next call gets a fresh one
+      packet_sp_ = PacketFactory::GetDefaultInstance()->Build();
+      WEBKIT_LOGERROR("in process dispatch timeout");
+      return Status::Error(StatusCode::eChannelReadError, "dispatch timeout");
+    }
+    s = call_sp->status;
+  }
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("dispatcher error status code %d message %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelReadError, "channel read error");
+  }
+  return Status::OK();
+}
+}  // namespace webkit
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+
+#include "webkit/channel.h"
+#include "webkit/client_config.h"
+#include "webkit/packet.h"
+#include "webkit/pool.h"
+
+namespace webkit {
+// channel to the dispatcher registered with DispatcherFactory in this very
+// process, the request is serialized into a packet and handed to a
+// dispatcher as the server would after reading it, no socket, no framing,
+// with a pool, e.g. ThreadServer::GetWorkerPool, the dispatch runs on a
+// worker and Read waits for it up to the socket timeout of the config,
+// without one it runs on the calling thread
+class InProcChannel : public Channel {
+ public:
+  InProcChannel(const ClientConfig *config, Pool *pool = nullptr);
+
+  virtual ~InProcChannel() = default;
+
+  // absolute CoarseClock ms the dispatcher must answer by, the request
+  // carries the earlier of it and the deadline of the request being served
+  void SetDeadlineMs(uint64_t deadline_ms);
+
+  // deadline timeout_ms from now, 0 sets none
+  void SetTimeoutMs(uint32_t timeout_ms);
+
+  Status Write(Serializer &serializer) override;
+
+  // dispatch the written request, then parse the reply
+  Status Read(Parser &parser) override;
+
+ private:
+  struct Call;
+
+  Status Dispatch();
+
+  const ClientConfig *config_;
+  Pool *pool_;
+  std::shared_ptr<Packet> packet_sp_;
+  uint64_t deadline_ms_;
+  bool is_dispatched_;
+};
+}  // namespace webkit
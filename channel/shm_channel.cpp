@@ -0,0 +1,29 @@
+#include "shm_channel.h"
+
+#include "webkit/logger.h"
+
+namespace webkit {
+ShmChannel::ShmChannel(const ClientConfig *config) : StreamChannel(config) {}
+
+Status ShmChannel::Open(const std::string &path) {
+  Status s = shm_socket_.Connect(path);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("shm channel socket connect failed %d %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelOpenError,
+                         "channel connect error");
+  }
+
+  s = shm_socket_.SetTimeout(config_->GetSockTimeoutSec());
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("shm channel socket set timeout failed %d %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelOpenError,
+                         "channel set timeout error");
+  }
+
+  return Status::OK();
+}
+
+StreamSocket &ShmChannel::GetSocket() { return shm_socket_; }
+}  // namespace webkit
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "channel/stream_channel.h"
+#include "socket/shm_socket.h"
+
+namespace webkit {
+// channel to a server on the same host accepting shm connections, see
+// ServerConfig::SetShmPath, requests and replies go through shared memory
+class ShmChannel : public StreamChannel {
+ public:
+  ShmChannel(const ClientConfig *config);
+
+  virtual ~ShmChannel() = default;
+
+  Status Open(const std::string &path);
+
+ protected:
+  StreamSocket &GetSocket() override;
+
+  ShmSocket shm_socket_;
+};
+}  // namespace webkit
@@ -46,8 +46,11 @@ Status SimpleAdapter::WriteHeader() {
   Status s = dst_.Write(p_src, src_length, write_size);
   header_size_ += write_size;
   if (!s.Ok() || header_size_ != sizeof(Header)) {
-    WEBKIT_LOGERROR("write dst expect %zu get %zu status code %d message %s",
-                    src_length, write_size, s.Code(), s.Message());
+    // a full socket buffer on a non blocking socket, the caller resumes
+    if (s.Code() != StatusCode::eRetry) {
+      WEBKIT_LOGERROR("write dst expect %zu get %zu status code %d message %s",
+                      src_length, write_size, s.Code(), s.Message());
+    }
     return s;
   }
   return Status::OK();
@@ -60,8 +63,11 @@ Status SimpleAdapter::WriteBody() {
   Status s = dst_.Write(src_, src_size_, write_size);
   src_size_ -= write_size;
   if (!s.Ok() || src_size_ != 0) {
-    WEBKIT_LOGERROR("write dst expect %zu get %zu status code %d message %s",
-                    src_size_ + write_size, write_size, s.Code(), s.Message());
+    if (s.Code() != StatusCode::eRetry) {
+      WEBKIT_LOGERROR("write dst expect %zu get %zu status code %d message %s",
+                      src_size_ + write_size, write_size, s.Code(),
+                      s.Message());
+    }
     return s;
   }
 
@@ -77,8 +83,11 @@ Status SimpleAdapter::ReadHeader() {
   Status s = dst_.Read(p_dst, dst_length, read_size);
   header_size_ += read_size;
   if (!s.Ok() || header_size_ != sizeof(Header)) {
-    WEBKIT_LOGERROR("read dst expect %zu get %zu status code %d message %s",
-                    dst_length, read_size, s.Code(), s.Message());
+    // no data yet is expected on a non blocking socket, the caller retries
+    if (s.Code() != StatusCode::eNoData) {
+      WEBKIT_LOGERROR("read dst expect %zu get %zu status code %d message %s",
+                      dst_length, read_size, s.Code(), s.Message());
+    }
     return s;
   }
 
@@ -99,8 +108,10 @@ Status SimpleAdapter::ReadBody() {
   Status s = dst_.Read(src_, dst_size_, read_size);
   dst_size_ -= read_size;
   if (!s.Ok() || dst_size_ != 0) {
-    WEBKIT_LOGERROR("read dst expect %zu get %zu status code %d message %s",
-                    dst_size_ + read_size, read_size, s.Code(), s.Message());
+    if (s.Code() != StatusCode::eNoData) {
+      WEBKIT_LOGERROR("read dst expect %zu get %zu status code %d message %s",
+                      dst_size_ + read_size, read_size, s.Code(), s.Message());
+    }
     return s;
   }
 
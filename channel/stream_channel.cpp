@@ -0,0 +1,73 @@
+#include "stream_channel.h"
+
+#include "util/coarse_clock.h"
+#include "util/trace_helper.h"
+#include "webkit/logger.h"
+#include "webkit/protocol_adapter.h"
+
+namespace webkit {
+StreamChannel::StreamChannel(const ClientConfig *config)
+    : config_(config), packet_sp_(nullptr), deadline_ms_(0) {
+  packet_sp_ = PacketFactory::GetDefaultInstance()->Build();
+}
+
+void StreamChannel::SetDeadlineMs(uint64_t deadline_ms) {
+  deadline_ms_ = deadline_ms;
+}
+
+void StreamChannel::SetTimeoutMs(uint32_t timeout_ms) {
+  deadline_ms_ =
+      timeout_ms == 0 ? 0 : CoarseClock::GetInstance()->NowMs() + timeout_ms;
+}
+
+Status StreamChannel::Write(Serializer &serializer) {
+  Status s;
+  TraceHelper *trace_helper = TraceHelper::GetInstance();
+  uint64_t inherit_deadline_ms = trace_helper->GetDeadlineMs();
+  if (deadline_ms_ != 0 &&
+      (inherit_deadline_ms == 0 || deadline_ms_ < inherit_deadline_ms)) {
+    trace_helper->SetDeadlineMs(deadline_ms_);
+  }
+  s = serializer.SerializeTo(*packet_sp_);
+  trace_helper->SetDeadlineMs(inherit_deadline_ms);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("serialize to error code %d message %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelWriteError, "channel write error");
+  }
+  std::shared_ptr<ProtocolAdapter> adapter_sp =
+      ProtocolAdapterFactory::GetDefaultInstance()->Build(
+          *packet_sp_, GetSocket(), packet_sp_->GetDataSize());
+  GetSocket().Cork(true);
+  s = adapter_sp->AdaptTo();
+  GetSocket().Cork(false);
+  if (s.Code() == StatusCode::eRetry) return s;
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("packet write socket error code %d message %s",
+                    s.Code(), s.Message());
+    return Status::Error(StatusCode::eChannelWriteError, "channel write error");
+  }
+  return s;
+}
+
+Status StreamChannel::Read(Parser &parser) {
+  std::shared_ptr<ProtocolAdapter> adapter_sp =
+      ProtocolAdapterFactory::GetDefaultInstance()->Build(*packet_sp_,
+                                                          GetSocket(), 0);
+  Status s = adapter_sp->AdaptFrom();
+  if (s.Code() == StatusCode::eRetry) return s;
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("packet read socket error code %d message %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelReadError, "channel read error");
+  }
+  s = parser.ParseFrom(*packet_sp_);
+  if (s.Code() == StatusCode::eRetry) return s;
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("packet read socket error code %d message %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelReadError, "channel read error");
+  }
+  return Status::OK();
+}
+}  // namespace webkit
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include "socket/stream_socket.h"
+#include "webkit/channel.h"
+#include "webkit/client_config.h"
+#include "webkit/packet.h"
+
+namespace webkit {
+// request and reply framing over a connected stream socket, subclasses own
+// the socket and know how to open it
+class StreamChannel : public Channel {
+ public:
+  StreamChannel(const ClientConfig *config);
+
+  virtual ~StreamChannel() = default;
+
+  // absolute CoarseClock ms the server must answer by, the request carries
+  // the earlier of it and the deadline of the request being served
+  void SetDeadlineMs(uint64_t deadline_ms);
+
+  // deadline timeout_ms from now, 0 sets none
+  void SetTimeoutMs(uint32_t timeout_ms);
+
+  Status Write(Serializer &serializer) override;
+
+  Status Read(Parser &parser) override;
+
+ protected:
+  virtual StreamSocket &GetSocket() = 0;
+
+  const ClientConfig *config_;
+  std::shared_ptr<Packet> packet_sp_;
+  uint64_t deadline_ms_;
+};
+}  // namespace webkit
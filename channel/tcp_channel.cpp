@@ -1,13 +1,9 @@
 #include "tcp_channel.h"
 
 #include "webkit/logger.h"
-#include "webkit/protocol_adapter.h"
 
 namespace webkit {
-TcpChannel::TcpChannel(const ClientConfig *config)
-    : config_(config), packet_sp_(nullptr) {
-  packet_sp_ = PacketFactory::GetDefaultInstance()->Build();
-}
+TcpChannel::TcpChannel(const ClientConfig *config) : StreamChannel(config) {}
 
 Status TcpChannel::Open(Router &router) {
   std::string ip;
@@ -18,7 +14,7 @@ Status TcpChannel::Open(Router &router) {
     return Status::Error(StatusCode::eChannelRouteError, "channel route error");
   }
 
-  s = tcp_socket_.Connect(ip, port);
+  s = tcp_socket_.Connect(ip, port, config_->GetSocketOption());
   if (!s.Ok()) {
     WEBKIT_LOGERROR("tcp channel socket connect failed %d %s", s.Code(),
                     s.Message());
@@ -37,45 +33,5 @@ Status TcpChannel::Open(Router &router) {
   return Status::OK();
 }
 
-Status TcpChannel::Write(Serializer &serializer) {
-  Status s;
-  s = serializer.SerializeTo(*packet_sp_);
-  if (!s.Ok()) {
-    WEBKIT_LOGERROR("serialize to error code %d message %s", s.Code(),
-                    s.Message());
-    return Status::Error(StatusCode::eChannelWriteError, "channel write error");
-  }
-  std::shared_ptr<ProtocolAdapter> adapter_sp =
-      ProtocolAdapterFactory::GetDefaultInstance()->Build(
-          *packet_sp_, tcp_socket_, packet_sp_->GetDataSize());
-  s = adapter_sp->AdaptTo();
-  if (s.Code() == StatusCode::eRetry) return s;
-  if (!s.Ok()) {
-    WEBKIT_LOGERROR("packet write tcp socket error code %d message %s",
-                    s.Code(), s.Message());
-    return Status::Error(StatusCode::eChannelWriteError, "channel write error");
-  }
-  return s;
-}
-
-Status TcpChannel::Read(Parser &parser) {
-  std::shared_ptr<ProtocolAdapter> adapter_sp =
-      ProtocolAdapterFactory::GetDefaultInstance()->Build(*packet_sp_,
-                                                          tcp_socket_, 0);
-  Status s = adapter_sp->AdaptFrom();
-  if (s.Code() == StatusCode::eRetry) return s;
-  if (!s.Ok()) {
-    WEBKIT_LOGERROR("packet read tcp socket error code %d message %s", s.Code(),
-                    s.Message());
-    return Status::Error(StatusCode::eChannelReadError, "channel read error");
-  }
-  s = parser.ParseFrom(*packet_sp_);
-  if (s.Code() == StatusCode::eRetry) return s;
-  if (!s.Ok()) {
-    WEBKIT_LOGERROR("packet read tcp socket error code %d message %s", s.Code(),
-                    s.Message());
-    return Status::Error(StatusCode::eChannelReadError, "channel read error");
-  }
-  return Status::OK();
-}
+StreamSocket &TcpChannel::GetSocket() { return tcp_socket_; }
 }  // namespace webkit
\ No newline at end of file
@@ -1,14 +1,11 @@
 #pragma once
 
-#include <functional>
-
+#include "channel/stream_channel.h"
 #include "socket/tcp_socket.h"
-#include "webkit/channel.h"
-#include "webkit/client_config.h"
 #include "webkit/router.h"
 
 namespace webkit {
-class TcpChannel : public Channel {
+class TcpChannel : public StreamChannel {
  public:
   TcpChannel(const ClientConfig *config);
 
@@ -16,13 +13,9 @@ class TcpChannel : public Channel {
 
   Status Open(Router &router);
 
-  Status Write(Serializer &serializer) override;
-
-  Status Read(Parser &parser) override;
-
  protected:
-  const ClientConfig *config_;
+  StreamSocket &GetSocket() override;
+
   TcpSocket tcp_socket_;
-  std::shared_ptr<Packet> packet_sp_;
 };
 }  // namespace webkit
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "unix_channel.h"
+
+#include "webkit/logger.h"
+
+namespace webkit {
+UnixChannel::UnixChannel(const ClientConfig *config) : StreamChannel(config) {}
+
+Status UnixChannel::Open(const std::string &path) {
+  Status s = unix_socket_.Connect(path);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("unix channel socket connect failed %d %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelOpenError,
+                         "channel connect error");
+  }
+
+  s = unix_socket_.SetTimeout(config_->GetSockTimeoutSec());
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("unix channel socket set timeout failed %d %s", s.Code(),
+                    s.Message());
+    return Status::Error(StatusCode::eChannelOpenError,
+                         "channel set timeout error");
+  }
+
+  return Status::OK();
+}
+
+StreamSocket &UnixChannel::GetSocket() { return unix_socket_; }
+}  // namespace webkit
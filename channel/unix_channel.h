@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "channel/stream_channel.h"
+#include "socket/unix_socket.h"
+
+namespace webkit {
+// channel to a server on the same host listening on a unix socket path, see
+// ServerConfig::SetUnixPath
+class UnixChannel : public StreamChannel {
+ public:
+  UnixChannel(const ClientConfig *config);
+
+  virtual ~UnixChannel() = default;
+
+  Status Open(const std::string &path);
+
+ protected:
+  StreamSocket &GetSocket() override;
+
+  UnixSocket unix_socket_;
+};
+}  // namespace webkit
@@ -1,12 +1,18 @@
 #include "string_dispatcher.h"
 
+#include <unistd.h>
+
+#include <chrono>
+
 #include "dispatcher/string_serialization.h"
+#include "metrics/metrics.h"
 #include "util/trace_helper.h"
+#include "webkit/admin_service.h"
 #include "webkit/logger.h"
 
 namespace webkit {
 Status StringDispatcher::Dispatch(Packet *packet) {
-  TraceHelper::GetInstance()->ClearTraceId();
+  TraceHelper::GetInstance()->Clear();
 
   Status s;
   std::string req;
@@ -21,25 +27,116 @@ Status StringDispatcher::Dispatch(Packet *packet) {
   }
 
   const StringSerialization::MetaInfo &meta_info = req_parser.GetMetaInfo();
-  TraceHelper::GetInstance()->SetTraceId(meta_info.trace_id);
+  TraceHelper *trace_helper = TraceHelper::GetInstance();
+  trace_helper->StartSpan(req_parser.GetTraceContext());
+  trace_helper->SetTimeoutMs(meta_info.timeout_ms);
   WEBKIT_LOGDEBUG("dispatch request method id %u", meta_info.method_id);
+  // the client has given up on a request that expired while queued, answer
+  // it without spending the handler time on it
+  if (trace_helper->IsDeadlineExceeded()) {
+    static Counter *deadline_drop_counter =
+        MetricsRegistry::GetInstance()->GetCounter("dispatch.deadline_drop");
+    deadline_drop_counter->Add();
+    WEBKIT_LOGDEBUG("method id %u request timeout %lu ms exceeded",
+                    meta_info.method_id, meta_info.timeout_ms);
+    return Reply(meta_info.method_id, StatusCode::eDeadlineExceeded, "",
+                 packet);
+  }
+  if (meta_info.method_id == kAdminMethodId) {
+    return Process(meta_info.method_id, req, packet);
+  }
 
+  // method ids come off the wire, ids without a handler share one set so
+  // the registry does not grow with whatever a peer sends
+  MetricsRegistry *registry = MetricsRegistry::GetInstance();
+  const MethodMetrics &method_metrics =
+      HasMethod(meta_info.method_id)
+          ? registry->GetMethodMetrics(meta_info.method_id)
+          : registry->GetUnknownMethodMetrics();
+  method_metrics.request->Add();
+  auto begin = std::chrono::steady_clock::now();
+  s = Process(meta_info.method_id, req, packet);
+  method_metrics.latency_us->Record(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - begin)
+          .count());
+  if (!s.Ok()) method_metrics.error->Add();
+  return s;
+}
+
+Status StringDispatcher::Peek(Packet *packet, uint32_t &method_id) {
+  return StringParser::PeekMethodId(*packet, method_id);
+}
+
+Status StringDispatcher::Reject(Packet *packet, int32_t status_code) {
+  std::string req;
+  StringParser req_parser(req);
+  Status s = req_parser.ParseFrom(*packet);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR(
+        "string parser parse from packet error status code %d message %s",
+        s.Code(), s.Message());
+    return Status::Error(StatusCode::eDisptachError, "parser parse from error");
+  }
+  TraceHelper::GetInstance()->StartSpan(req_parser.GetTraceContext());
+  return Reply(req_parser.GetMetaInfo().method_id, status_code, "", packet);
+}
+
+Status StringDispatcher::Process(uint32_t method_id, const std::string &req,
+                                 Packet *packet) {
+  Status s;
   std::string rsp;
-  s = Forward(meta_info.method_id, req, rsp);
+  AdminService *admin_service = AdminService::GetDefaultInstance();
+  if (method_id == kAdminMethodId && admin_service != nullptr) {
+    s = admin_service->Handle(req, rsp);
+  } else {
+    FileRegion file;
+    s = ForwardFile(method_id, req, file);
+    if (file.fd >= 0) {
+      if (s.Ok()) return ReplyFile(method_id, file, packet);
+      close(file.fd);
+    }
+    if (s.Ok()) s = Forward(method_id, req, rsp);
+  }
   if (!s.Ok()) {
     WEBKIT_LOGERROR(
         "method id %u request forward error status code %d message %s",
-        meta_info.method_id, s.Code(), s.Message());
+        method_id, s.Code(), s.Message());
     return Status::Error(StatusCode::eDisptachError, "forward request error");
   }
 
-  StringSerializer rsp_serializer(meta_info.method_id, rsp);
-  s = rsp_serializer.SerializeTo(*packet);
+  return Reply(method_id, StatusCode::eOk, rsp, packet);
+}
+
+Status StringDispatcher::Reply(uint32_t method_id, int32_t status_code,
+                               const std::string &rsp, Packet *packet) {
+  StringSerializer rsp_serializer(method_id, rsp);
+  rsp_serializer.SetStatusCode(status_code);
+  Status s = rsp_serializer.SerializeTo(*packet);
   if (!s.Ok()) {
     WEBKIT_LOGERROR(
         "method id %u string serializer serialze to error status code %d "
         "message %s",
-        meta_info.method_id, s.Code(), s.Message());
+        method_id, s.Code(), s.Message());
+    return Status::Error(StatusCode::eDisptachError,
+                         "serializer serialize to error");
+  }
+
+  return Status::OK();
+}
+
+Status StringDispatcher::ReplyFile(uint32_t method_id, const FileRegion &file,
+                                   Packet *packet) {
+  std::string rsp;
+  StringSerializer rsp_serializer(method_id, rsp);
+  rsp_serializer.SetFile(file.fd, file.offset, file.size);
+  Status s = rsp_serializer.SerializeTo(*packet);
+  if (!s.Ok()) {
+    close(file.fd);
+    WEBKIT_LOGERROR(
+        "method id %u string serializer serialze file error status code %d "
+        "message %s",
+        method_id, s.Code(), s.Message());
     return Status::Error(StatusCode::eDisptachError,
                          "serializer serialize to error");
   }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <sys/types.h>
+
 #include <string>
 
 #include "webkit/dispatcher.h"
@@ -13,7 +15,34 @@ class StringDispatcher : public Dispatcher {
 
   Status Dispatch(Packet *p_packet) override;
 
+  Status Peek(Packet *p_packet, uint32_t &method_id) override;
+
+  Status Reject(Packet *p_packet, int32_t status_code) override;
+
   virtual Status Forward(uint32_t method_id, const std::string &req,
                          std::string &rsp) = 0;
+
+  struct FileRegion {
+    int fd = -1;
+    off_t offset = 0;
+    size_t size = 0;
+  };
+
+  // a method may answer with a file instead of a string by setting
+  // file.fd, its bytes are then sent from the page cache with sendfile and
+  // fd is closed after, methods that leave fd unset go to Forward
+  virtual Status ForwardFile(uint32_t /*method_id*/,
+                             const std::string & /*req*/,
+                             FileRegion & /*file*/) {
+    return Status::OK();
+  }
+
+ private:
+  Status Process(uint32_t method_id, const std::string &req, Packet *packet);
+
+  Status Reply(uint32_t method_id, int32_t status_code, const std::string &rsp,
+               Packet *packet);
+
+  Status ReplyFile(uint32_t method_id, const FileRegion &file, Packet *packet);
 };
 }  // namespace webkit
\ No newline at end of file
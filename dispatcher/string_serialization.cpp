@@ -53,7 +53,7 @@
 
 namespace webkit {
 StringSerializer::StringSerializer(uint32_t method_id, const std::string &str)
-    : str_(str) {
+    : str_(str), fd_(-1), offset_(0) {
   memset(&meta_info_, 0, sizeof(MetaInfo));
   meta_info_.meta_length =
       InetUtil::Hton(static_cast<uint32_t>(sizeof(MetaInfo)));
@@ -63,13 +63,32 @@ StringSerializer::StringSerializer(uint32_t method_id, const std::string &str)
 }
 
 Status StringSerializer::SerializeTo(Packet &packet) {
-  const std::string &trace_id = TraceHelper::GetInstance()->GetTraceId();
-  strncpy(meta_info_.trace_id, trace_id.data(), trace_id.length());
+  const TraceContext &context = TraceHelper::GetInstance()->GetContext();
+  meta_info_.trace_id = InetUtil::Hton(context.trace_id);
+  meta_info_.span_id = InetUtil::Hton(context.span_id);
+  meta_info_.parent_id = InetUtil::Hton(context.parent_id);
+  meta_info_.trace_flags = context.flags;
+  meta_info_.timeout_ms =
+      InetUtil::Hton(TraceHelper::GetInstance()->GetTimeoutMs());
   PACKET_WRITE_RETURN_IF_ERROR(packet, &meta_info_, sizeof(MetaInfo));
+  if (fd_ >= 0) {
+    return packet.AppendFile(fd_, offset_,
+                             InetUtil::Ntoh(meta_info_.message_length));
+  }
   PACKET_WRITE_RETURN_IF_ERROR(packet, str_.data(), str_.length());
   return Status::OK();
 }
 
+void StringSerializer::SetStatusCode(int32_t status_code) {
+  meta_info_.status_code = InetUtil::Hton(status_code);
+}
+
+void StringSerializer::SetFile(int fd, off_t offset, size_t size) {
+  fd_ = fd;
+  offset_ = offset;
+  meta_info_.message_length = InetUtil::Hton(static_cast<uint32_t>(size));
+}
+
 StringParser::StringParser(std::string &str) : str_(str) {
   memset(&meta_info_, 0, sizeof(MetaInfo));
 }
@@ -93,8 +112,12 @@ Status StringParser::ParseFrom(Packet &packet) {
   }
   meta_info_.method_id = InetUtil::Ntoh(meta_info_.method_id);
   meta_info_.message_length = InetUtil::Ntoh(meta_info_.message_length);
+  meta_info_.trace_id = InetUtil::Ntoh(meta_info_.trace_id);
+  meta_info_.span_id = InetUtil::Ntoh(meta_info_.span_id);
+  meta_info_.parent_id = InetUtil::Ntoh(meta_info_.parent_id);
+  meta_info_.timeout_ms = InetUtil::Ntoh(meta_info_.timeout_ms);
+  meta_info_.status_code = InetUtil::Ntoh(meta_info_.status_code);
   str_.resize(meta_info_.message_length);
-  TraceHelper::GetInstance()->SetTraceId(meta_info_.trace_id);
   PACKET_READ_RETURN_IF_ERROR(packet, &str_[0], str_.length());
   return Status::OK();
 }
@@ -102,4 +125,27 @@ Status StringParser::ParseFrom(Packet &packet) {
 const StringSerialization::MetaInfo &StringParser::GetMetaInfo() const {
   return meta_info_;
 }
+
+Status StringParser::PeekMethodId(Packet &packet, uint32_t &method_id) {
+  uint32_t head[2];
+  size_t read_size = 0;
+  Status s = packet.Peek(head, sizeof(head), read_size);
+  if (!s.Ok()) return s;
+  if (read_size != sizeof(head)) {
+    return Status::ErrorF(StatusCode::eParseError,
+                          "packet peek expect %zu get %zu", sizeof(head),
+                          read_size);
+  }
+  method_id = InetUtil::Ntoh(head[1]);
+  return Status::OK();
+}
+
+TraceContext StringParser::GetTraceContext() const {
+  TraceContext context;
+  context.trace_id = meta_info_.trace_id;
+  context.span_id = meta_info_.span_id;
+  context.parent_id = meta_info_.parent_id;
+  context.flags = meta_info_.trace_flags;
+  return context;
+}
 } // namespace webkit
\ No newline at end of file
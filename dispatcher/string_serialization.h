@@ -1,7 +1,10 @@
 #pragma once
 
+#include <sys/types.h>
+
 #include <string>
 
+#include "util/trace_helper.h"
 #include "webkit/serialization.h"
 
 namespace webkit {
@@ -12,7 +15,13 @@ public:
     uint32_t meta_length;
     uint32_t method_id;
     uint32_t message_length;
-    char trace_id[32];
+    uint64_t trace_id;
+    uint64_t span_id;
+    uint64_t parent_id;
+    uint8_t trace_flags;
+    // ms the sender still waits for the response, 0 means no limit
+    uint64_t timeout_ms;
+    int32_t status_code;
   };
 #pragma pack(pop)
 };
@@ -25,9 +34,19 @@ public:
 
   virtual Status SerializeTo(Packet &packet) override;
 
+  // status of a response, the body is empty unless the code is eOk
+  void SetStatusCode(int32_t status_code);
+
+  // the body is size bytes of the file fd from offset instead of the
+  // string, appended to the packet unread, the packet owns fd once
+  // serialized, the caller still does on error
+  void SetFile(int fd, off_t offset, size_t size);
+
 private:
   const std::string &str_;
   MetaInfo meta_info_;
+  int fd_;
+  off_t offset_;
 };
 
 class StringParser : public Parser, public StringSerialization {
@@ -40,6 +59,11 @@ public:
 
   const MetaInfo &GetMetaInfo() const;
 
+  TraceContext GetTraceContext() const;
+
+  // method id of the frame at the head of packet, packet is left untouched
+  static Status PeekMethodId(Packet &packet, uint32_t &method_id);
+
 private:
   std::string &str_;
   MetaInfo meta_info_;
@@ -6,6 +6,7 @@
 #include "dispatcher/string_serialization.h"
 #include "util/generator.h"
 #include "util/trace_helper.h"
+#include "webkit/admin_service.h"
 #include "webkit/logger.h"
 
 using webkit::Status;
@@ -14,19 +15,33 @@ JsonServerClient::JsonServerClient(webkit::ClientConfig *config)
     : config_(config) {}
 
 Status JsonServerClient::Echo(const std::string &req, std::string &rsp) {
-  std::string trace_id = webkit::UidGenerator::GetInstance()->Generate();
-  webkit::TraceHelper::GetInstance()->SetTraceId(trace_id);
+  return Call(eMethodIdEcho, req, rsp);
+}
+
+Status JsonServerClient::Stats(std::string &rsp) {
+  return Call(webkit::kAdminMethodId, "", rsp);
+}
+
+Status JsonServerClient::Call(uint32_t method_id, const std::string &req,
+                              std::string &rsp) {
+  uint64_t trace_id =
+      webkit::TraceHelper::GetInstance()->StartTrace().trace_id;
 
   webkit::TcpChannel channel(config_);
-  webkit::HashRouter<std::string> router(config_, trace_id);
+  webkit::HashRouter<uint64_t> router(config_, trace_id);
   Status s = channel.Open(router);
   if (!s.Ok()) {
     WEBKIT_LOGERROR("channel open error");
     return Status::Error(-1);
   }
+  // the read gives up after the socket timeout, so may the server, a
+  // timeout of 0 waits forever and sets no deadline
+  if (config_->GetSockTimeoutSec() > 0) {
+    channel.SetTimeoutMs(config_->GetSockTimeoutSec() * 1000);
+  }
 
   static constexpr int kRetryCount = 3;
-  webkit::StringSerializer req_serializer(eMethodIdEcho, req);
+  webkit::StringSerializer req_serializer(method_id, req);
   for (int i = 0; i < kRetryCount; i++) {
     s = channel.Write(req_serializer);
     if (s.Code() != webkit::StatusCode::eRetry) break;
@@ -45,10 +60,15 @@ Status JsonServerClient::Echo(const std::string &req, std::string &rsp) {
     WEBKIT_LOGERROR("channel read error");
     return Status::Error(-1);
   }
-  if (rsp_parser.GetMetaInfo().method_id != eMethodIdEcho) {
+  if (rsp_parser.GetMetaInfo().method_id != method_id) {
     WEBKIT_LOGERROR("method id error");
     return Status::Error(-1);
   }
+  if (rsp_parser.GetMetaInfo().status_code != webkit::StatusCode::eOk) {
+    WEBKIT_LOGERROR("response status code %d",
+                    rsp_parser.GetMetaInfo().status_code);
+    return Status::Error(rsp_parser.GetMetaInfo().status_code);
+  }
 
   return Status::OK();
 }
\ No newline at end of file
@@ -11,6 +11,11 @@ class JsonServerClient {
 
   webkit::Status Echo(const std::string &req, std::string &rsp);
 
+  webkit::Status Stats(std::string &rsp);
+
  private:
+  webkit::Status Call(uint32_t method_id, const std::string &req,
+                      std::string &rsp);
+
   webkit::ClientConfig *config_;
 };
\ No newline at end of file
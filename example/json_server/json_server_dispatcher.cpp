@@ -7,6 +7,10 @@ using webkit::Dispatcher;
 using webkit::Status;
 using webkit::StatusCode::WebkitCode;
 
+bool JsonServerDispatcher::HasMethod(uint32_t method_id) const {
+  return method_id == eMethodIdEcho;
+}
+
 Status JsonServerDispatcher::Forward(uint32_t method_id, const std::string &req,
                                      std::string &rsp) {
   nlohmann::json req_json = nlohmann::json::parse(req, nullptr, false);
@@ -12,6 +12,8 @@ class JsonServerDispatcher : public webkit::StringDispatcher {
   webkit::Status Forward(uint32_t method_id, const std::string &req,
                          std::string &rsp) override;
 
+  bool HasMethod(uint32_t method_id) const override;
+
  private:
   JsonServerImpl server_impl_;
 };
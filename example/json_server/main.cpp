@@ -7,8 +7,9 @@
 #include "channel/simple_adapter.h"
 #include "json_server_client.h"
 #include "json_server_dispatcher.h"
+#include "logger/async_logger.h"
+#include "logger/binary_logger.h"
 #include "logger/chain_logger.h"
-#include "logger/comm_logger.h"
 #include "logger/stdout_logger.h"
 #include "packet/byte_packet.h"
 #include "pool/thread_pool.h"
@@ -44,10 +45,20 @@ int main(int argc, char *argv[]) {
   RegisterSignalHandler();
 
   webkit::StdoutLogger stdout_logger;
-  auto comm_logger_up = webkit::CommLogger::Open("json_server.log");
-  webkit::ChainLogger chain_logger(&stdout_logger, comm_logger_up.get());
+  auto async_logger_up = webkit::AsyncLogger::Open("json_server.log");
+  webkit::ChainLogger chain_logger(&stdout_logger);
+  if (async_logger_up != nullptr) {
+    chain_logger.Push(async_logger_up.get());
+  } else {
+    printf("open json_server.log error, log to stdout only\n");
+  }
   webkit::Logger::SetDefaultInstance(&chain_logger);
   webkit::Logger::SetLogLevel(webkit::Logger::eDebug);
+#ifdef WEBKIT_BINARY_LOG
+  // decode with webkit_log_decoder json_server.blog
+  auto binary_logger_up = webkit::AsyncBinaryLogger::Open("json_server.blog");
+  webkit::BinaryLogger::SetDefaultInstance(binary_logger_up.get());
+#endif
 
   webkit::SimpleAdapterFactory adapter_factory;
   webkit::ProtocolAdapterFactory::SetDefaultInstance(&adapter_factory);
@@ -95,6 +106,10 @@ int main(int argc, char *argv[]) {
   s = client.Echo(req, rsp);
   printf("rsp %s\n", rsp.c_str());
 
+  std::string stats;
+  s = client.Stats(stats);
+  printf("stats\n%s", stats.c_str());
+
   server.Stop();
   WEBKIT_LOGINFO("json server stopped");
   return 0;
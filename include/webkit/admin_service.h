@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "webkit/instance_base.h"
+#include "webkit/status.h"
+
+namespace webkit {
+// reserved method id, requests carrying it are served by the default admin
+// service before they reach the user dispatcher
+static constexpr uint32_t kAdminMethodId = 0xFFFFFFFFU;
+
+// admin request bodies understood by the server, anything else returns the
+// runtime stats
+static constexpr char kAdminSlowRequest[] = "slow";
+
+class AdminService : public InstanceBase<AdminService> {
+ public:
+  AdminService() = default;
+
+  virtual ~AdminService() = default;
+
+  virtual Status Handle(const std::string &req, std::string &rsp) = 0;
+};
+}  // namespace webkit
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "webkit/instance_base.h"
+#include "webkit/logger.h"
+
+// FORMAT must be a string literal, the call site metadata is built at compile
+// time and only the arguments are captured on the calling thread
+#define WEBKIT_BLOG(LEVEL, FORMAT, ...)                                      \
+  do {                                                                       \
+    if (!webkit::BinaryLogger::IsLogEnable((LEVEL))) break;                  \
+    static constexpr webkit::LogSite kWebkitLogSite{                         \
+        (LEVEL), webkit::Logger::Basename(__FILE__), __LINE__, __func__,     \
+        FORMAT};                                                             \
+    static const uint32_t kWebkitLogSiteId =                                 \
+        webkit::BinaryLogger::RegisterSite(&kWebkitLogSite);                 \
+    webkit::BinaryLogger::GetDefaultInstance()->Log(kWebkitLogSiteId,        \
+                                                    ##__VA_ARGS__);          \
+  } while (false)
+
+namespace webkit {
+struct LogSite {
+  Logger::Level level;
+  const char *file;
+  int line;
+  const char *func;
+  const char *format;
+};
+
+// record layout, all integers are in host byte order
+//   file header: kMagic
+//   site record: eRecordSite u32 site_id u8 level u32 line
+//                u32 file_len file u32 func_len func u32 format_len format
+//   log record:  eRecordLog u32 site_id u64 timestamp_ns u32 args_size args
+//   argument:    u8 arg_type value, string value is u32 len followed by bytes
+class BinaryLogger : public InstanceBase<BinaryLogger> {
+ public:
+  enum RecordType : uint8_t {
+    eRecordSite = 'S',
+    eRecordLog = 'L',
+  };
+
+  enum ArgType : uint8_t {
+    eArgInt = 1,
+    eArgUint = 2,
+    eArgDouble = 3,
+    eArgString = 4,
+    eArgPointer = 5,
+  };
+
+  static constexpr char kMagic[8] = {'W', 'K', 'B', 'L', 'O', 'G', '0', '1'};
+
+  static constexpr size_t kMaxRecordSize = 4096;
+
+  BinaryLogger() : level_(Logger::eDebug) {}
+
+  virtual ~BinaryLogger() = default;
+
+  virtual void Write(const void *record, size_t size) = 0;
+
+  virtual void Flush() {}
+
+  virtual uint64_t GetDropCount() const { return 0; }
+
+  template <typename... Args>
+  void Log(uint32_t site_id, const Args &...args) {
+    Encoder encoder;
+    encoder.Put(eRecordLog);
+    encoder.Put(site_id);
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    encoder.Put(static_cast<uint64_t>(ts.tv_sec) * 1000000000UL +
+                static_cast<uint64_t>(ts.tv_nsec));
+    size_t args_size_pos = encoder.Size();
+    encoder.Put(static_cast<uint32_t>(0));
+    (encoder.Encode(args), ...);
+    encoder.Patch(args_size_pos,
+                  static_cast<uint32_t>(encoder.Size() - args_size_pos -
+                                        sizeof(uint32_t)));
+    Write(encoder.Data(), encoder.Size());
+  }
+
+  void SetLevel(Logger::Level level) { level_ = level; }
+
+  Logger::Level GetLevel() const { return level_; }
+
+  static bool IsLogEnable(Logger::Level level) {
+    if (GetDefaultInstance() == nullptr) return false;
+    return GetDefaultInstance()->GetLevel() <= level;
+  }
+
+  static uint32_t RegisterSite(const LogSite *site);
+
+  static size_t GetSiteNum();
+
+  static const LogSite *GetSite(uint32_t site_id);
+
+ private:
+  class Encoder {
+   public:
+    Encoder() : size_(0) {}
+
+    template <typename T>
+    void Put(T value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      PutBytes(&value, sizeof(T));
+    }
+
+    void PutBytes(const void *data, size_t size) {
+      if (size_ + size > kMaxRecordSize) size = kMaxRecordSize - size_;
+      memcpy(buffer_ + size_, data, size);
+      size_ += size;
+    }
+
+    void PutString(const char *str, size_t len) {
+      static constexpr size_t kStringHeadSize = 1 + sizeof(uint32_t);
+      if (size_ + kStringHeadSize > kMaxRecordSize) return;
+      len = std::min(len, kMaxRecordSize - size_ - kStringHeadSize);
+      Put(eArgString);
+      Put(static_cast<uint32_t>(len));
+      PutBytes(str, len);
+    }
+
+    template <typename T>
+    void Encode(const T &value) {
+      using U = std::decay_t<T>;
+      if constexpr (std::is_same_v<U, bool>) {
+        PutArg(eArgUint, static_cast<uint64_t>(value));
+      } else if constexpr (std::is_enum_v<U>) {
+        Encode(static_cast<std::underlying_type_t<U>>(value));
+      } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        PutArg(eArgInt, static_cast<int64_t>(value));
+      } else if constexpr (std::is_integral_v<U>) {
+        PutArg(eArgUint, static_cast<uint64_t>(value));
+      } else if constexpr (std::is_floating_point_v<U>) {
+        PutArg(eArgDouble, static_cast<double>(value));
+      } else if constexpr (std::is_same_v<U, char *> ||
+                           std::is_same_v<U, const char *>) {
+        const char *str = value == nullptr ? "(null)" : value;
+        PutString(str, strlen(str));
+      } else if constexpr (std::is_convertible_v<const U &, std::string_view>) {
+        std::string_view str(value);
+        PutString(str.data(), str.length());
+      } else if constexpr (std::is_pointer_v<U>) {
+        PutArg(eArgPointer, reinterpret_cast<uint64_t>(value));
+      } else {
+        static_assert(sizeof(U) == 0, "unsupported binary log argument type");
+      }
+    }
+
+    // string literals and char buffers, never null, and not read past N
+    template <size_t N>
+    void Encode(const char (&value)[N]) {
+      PutString(value, strnlen(value, N));
+    }
+
+    void Patch(size_t pos, uint32_t value) {
+      memcpy(buffer_ + pos, &value, sizeof(value));
+    }
+
+    const char *Data() const { return buffer_; }
+
+    size_t Size() const { return size_; }
+
+   private:
+    template <typename T>
+    void PutArg(ArgType type, T value) {
+      if (size_ + 1 + sizeof(T) > kMaxRecordSize) return;
+      Put(type);
+      Put(value);
+    }
+
+    char buffer_[kMaxRecordSize];
+    size_t size_;
+  };
+
+  Logger::Level level_;
+};
+}  // namespace webkit
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "webkit/socket_option.h"
+
 namespace webkit {
 class ClientConfig {
  public:
@@ -29,9 +31,18 @@ class ClientConfig {
   }
   virtual int GetSockTimeoutUsec() const { return sock_timeout_usec_; }
 
+  // options of the tcp connections channels open
+  virtual void SetSocketOption(const SocketOption &socket_option) {
+    socket_option_ = socket_option;
+  }
+  virtual const SocketOption &GetSocketOption() const {
+    return socket_option_;
+  }
+
  protected:
   std::vector<Host> host_vec_;
   int sock_timeout_sec_;
   int sock_timeout_usec_;
+  SocketOption socket_option_;
 };
 }  // namespace webkit
\ No newline at end of file
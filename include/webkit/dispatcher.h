@@ -12,6 +12,18 @@ class Dispatcher {
   virtual ~Dispatcher() = default;
 
   virtual Status Dispatch(Packet *p_packet) = 0;
+
+  // read the method id of the request in packet without consuming it, the
+  // server calls it on the io thread to classify a request before queueing
+  virtual Status Peek(Packet *p_packet, uint32_t &method_id) = 0;
+
+  // whether method_id has a handler, method ids come off the wire, so per
+  // method state is only kept for these, called on the io thread
+  virtual bool HasMethod(uint32_t method_id) const = 0;
+
+  // consume the request in packet and write a response carrying only
+  // status_code, used to shed a request without running its handler
+  virtual Status Reject(Packet *p_packet, int32_t status_code) = 0;
 };
 
 using DispatcherFactory = ClassFactory<Dispatcher>;
@@ -5,8 +5,12 @@
 #include "webkit/packet.h"
 #include "webkit/socket.h"
 #include "webkit/status.h"
+#include "webkit/task.h"
 
 namespace webkit {
+class StageTrace;
+struct TraceContext;
+
 class Event : public std::enable_shared_from_this<Event> {
  public:
   Event() = default;
@@ -17,14 +21,30 @@ class Event : public std::enable_shared_from_this<Event> {
 
   virtual bool IsReadyToSend() const = 0;
 
+  // a send stopped on a full socket buffer, wait until there is room again,
+  // IsReadyToSend holds in this state too
+  virtual void SetReadyToResume() = 0;
+
   virtual void SetReadyToRecv() = 0;
 
   virtual bool IsReadyToRecv() const = 0;
 
+  // sent, but the kernel still sends from the packet, only completions on
+  // the socket error queue are waited for
+  virtual void SetReadyToReap() = 0;
+
+  virtual bool IsReadyToReap() const = 0;
+
   virtual void ClearEvent() = 0;
 
+  // write the packet as one frame, eRetry if the socket buffer filled up,
+  // the next call continues where this one stopped
   virtual Status Send() = 0;
 
+  // eRetry until the kernel released all the packet memory it was handed
+  virtual Status Reap() = 0;
+
+  // read one frame into the packet, eRetry if only part of it has arrived
   virtual Status Recv() = 0;
 
   virtual void SetSocket(std::shared_ptr<Socket> socket_sp) = 0;
@@ -41,8 +61,17 @@ class Event : public std::enable_shared_from_this<Event> {
 
   virtual Status ModInReactor() = 0;
 
+  // run task on the io thread waiting on the reactor of the event
+  virtual Status PostToReactor(Task task) = 0;
+
   virtual void SetBusy(bool is_busy) = 0;
 
   virtual bool IsBusy() const = 0;
+
+  virtual StageTrace *GetStageTrace() = 0;
+
+  // trace of the request being served, handed from the recv worker to the
+  // send worker
+  virtual TraceContext *GetTraceContext() = 0;
 };
 }  // namespace webkit
\ No newline at end of file
@@ -1,39 +1,42 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "third_party/fmt/include/fmt/printf.h"
 #include "webkit/instance_base.h"
 
-#define WEBKIT_LOG(LEVEL, FORMAT, ...)                                        \
-  do {                                                                        \
-    if (!webkit::Logger::IsLogEnable((LEVEL))) break;                         \
-    const char *file_ptr = strrchr(__FILE__, '/');                            \
-    if (file_ptr == nullptr) {                                                \
-      file_ptr = __FILE__;                                                    \
-    } else {                                                                  \
-      file_ptr++;                                                             \
-    }                                                                         \
-    webkit::Logger::GetDefaultInstance()->LogF(                               \
-        (LEVEL), fmt::sprintf("%s %s\n", "[%s] %s:%d(%s)", (FORMAT)),         \
-        webkit::Logger::LevelToString((LEVEL)), file_ptr, __LINE__, __func__, \
-        ##__VA_ARGS__);                                                       \
+#ifdef WEBKIT_BINARY_LOG
+#define WEBKIT_LOG(LEVEL, FORMAT, ...) WEBKIT_BLOG(LEVEL, FORMAT, ##__VA_ARGS__)
+#else
+#define WEBKIT_LOG(LEVEL, FORMAT, ...)                                   \
+  do {                                                                   \
+    if (!webkit::Logger::IsLogEnable((LEVEL))) break;                    \
+    static constexpr const char *kWebkitLogFile =                        \
+        webkit::Logger::Basename(__FILE__);                              \
+    webkit::Logger::GetDefaultInstance()->LogWithPrefixF(                \
+        (LEVEL), "%s[%s] %s:%d(%s) " FORMAT "\n%s",                      \
+        webkit::Logger::LevelToString((LEVEL)), kWebkitLogFile, __LINE__, \
+        __func__, ##__VA_ARGS__);                                        \
   } while (false)
+#endif
 
 #define WEBKIT_LOGDEBUG(FORMAT, ...) \
-  WEBKIT_LOG(webkit::Logger::eDebug, (FORMAT), ##__VA_ARGS__)
+  WEBKIT_LOG(webkit::Logger::eDebug, FORMAT, ##__VA_ARGS__)
 
 #define WEBKIT_LOGINFO(FORMAT, ...) \
-  WEBKIT_LOG(webkit::Logger::eInfo, (FORMAT), ##__VA_ARGS__)
+  WEBKIT_LOG(webkit::Logger::eInfo, FORMAT, ##__VA_ARGS__)
 
 #define WEBKIT_LOGWARN(FORMAT, ...) \
-  WEBKIT_LOG(webkit::Logger::eWarn, (FORMAT), ##__VA_ARGS__)
+  WEBKIT_LOG(webkit::Logger::eWarn, FORMAT, ##__VA_ARGS__)
 
 #define WEBKIT_LOGERROR(FORMAT, ...) \
-  WEBKIT_LOG(webkit::Logger::eError, (FORMAT), ##__VA_ARGS__)
+  WEBKIT_LOG(webkit::Logger::eError, FORMAT, ##__VA_ARGS__)
 
 #define WEBKIT_LOGFATAL(FORMAT, ...) \
-  WEBKIT_LOG(webkit::Logger::eFatal, (FORMAT), ##__VA_ARGS__)
+  WEBKIT_LOG(webkit::Logger::eFatal, FORMAT, ##__VA_ARGS__)
 
 namespace webkit {
 class Logger : public InstanceBase<Logger> {
@@ -51,20 +54,48 @@ class Logger : public InstanceBase<Logger> {
 
   virtual ~Logger() = default;
 
+  static constexpr size_t kMaxPrefixSize = 256;
+
   virtual void Log(Level level, const std::string &message) = 0;
 
   template <typename... Args>
   void LogF(Level level, const std::string &format, Args &&...args) {
     using namespace std::string_literals;
     if (!IsLogEnable(level)) return;
-    Log(level, fmt::sprintf("%s"s + format + "%s"s, GetPrefix(),
+    char prefix[kMaxPrefixSize];
+    size_t prefix_size = FormatPrefix(prefix, sizeof(prefix));
+    Log(level, fmt::sprintf("%s"s + format + "%s"s,
+                            fmt::string_view(prefix, prefix_size),
                             std::forward<Args>(args)..., GetSuffix()));
   }
 
+  // format must begin with a %s for the prefix and end with a %s for the
+  // suffix, saves building the format string at runtime
+  template <typename... Args>
+  void LogWithPrefixF(Level level, const char *format, Args &&...args) {
+    if (!IsLogEnable(level)) return;
+    char prefix[kMaxPrefixSize];
+    size_t prefix_size = FormatPrefix(prefix, sizeof(prefix));
+    Log(level, fmt::sprintf(format, fmt::string_view(prefix, prefix_size),
+                            std::forward<Args>(args)..., GetSuffix()));
+  }
+
+  // write prefix into buf, return the written size
+  virtual size_t FormatPrefix(char *buf, size_t size) {
+    std::string prefix = GetPrefix();
+    size_t prefix_size = std::min(prefix.length(), size);
+    memcpy(buf, prefix.data(), prefix_size);
+    return prefix_size;
+  }
+
   virtual std::string GetPrefix() { return ""; }
 
   virtual std::string GetSuffix() { return ""; }
 
+  virtual void Flush() {}
+
+  virtual uint64_t GetDropCount() const { return 0; }
+
   void SetLevel(Level level) { level_ = level; }
 
   Level GetLevel() const { return level_; }
@@ -102,7 +133,7 @@ class Logger : public InstanceBase<Logger> {
 
   template <typename... Args>
   static void WarnF(const std::string &format, Args &&...args) {
-    GetDefaultInstance()->Log(eWarn, format, std::forward<Args>(args)...);
+    GetDefaultInstance()->LogF(eWarn, format, std::forward<Args>(args)...);
   }
 
   static void Error(const std::string &message) {
@@ -123,6 +154,14 @@ class Logger : public InstanceBase<Logger> {
     GetDefaultInstance()->LogF(eFatal, format, std::forward<Args>(args)...);
   }
 
+  static constexpr const char *Basename(const char *path) {
+    const char *basename = path;
+    for (; *path != '\0'; path++) {
+      if (*path == '/') basename = path + 1;
+    }
+    return basename;
+  }
+
   static std::string LevelToString(Level level) {
     static constexpr const char *level_strings[]{"",
                                                  "\x1B[32mDebug\x1B[0m",
@@ -136,4 +175,8 @@ class Logger : public InstanceBase<Logger> {
  protected:
   Level level_;
 };
-}  // namespace webkit
\ No newline at end of file
+}  // namespace webkit
+
+#ifdef WEBKIT_BINARY_LOG
+#include "webkit/binary_logger.h"
+#endif
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <sys/types.h>
+
 #include <iostream>
 #include <memory>
 
@@ -10,6 +12,15 @@
 namespace webkit {
 class Packet : public IoBase, public std::iostream {
  public:
+  // contiguous piece at the head of the data, size bytes at data, or size
+  // bytes of the file fd from offset if data is null
+  struct Span {
+    const void *data;
+    int fd;
+    off_t offset;
+    size_t size;
+  };
+
   Packet(std::streambuf *p_buf) : std::iostream(p_buf) {}
 
   virtual ~Packet() = default;
@@ -18,6 +29,21 @@ class Packet : public IoBase, public std::iostream {
 
   using IoBase::Read;
 
+  // copy up to dst_size bytes from the head of the packet without
+  // consuming them
+  virtual Status Peek(void *dst, size_t dst_size, size_t &read_size) = 0;
+
+  // append size bytes of the file fd from offset without reading them, the
+  // packet owns fd from then on, nothing may be written after it, sockets
+  // send the bytes straight from the page cache, reads copy them
+  virtual Status AppendFile(int fd, off_t offset, size_t size) = 0;
+
+  // head of the data for sending it without a copy, size 0 if empty
+  virtual Span GetSpan() = 0;
+
+  // drop size bytes from the head once they are sent
+  virtual void Consume(size_t size) = 0;
+
   virtual void Clear() = 0;
 
   virtual size_t GetDataSize() const = 0;
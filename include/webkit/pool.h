@@ -1,24 +1,60 @@
 #pragma once
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include "webkit/class_factory.h"
 #include "webkit/status.h"
+#include "webkit/task.h"
 
 namespace webkit {
 class Pool {
  public:
-  using FuncType = std::function<void()>;
+  using FuncType = Task;
 
   Pool() = default;
 
   virtual ~Pool() = default;
 
+  // worker i runs on cpu_vec[i % size], empty leaves workers unpinned,
+  // takes effect on Run
+  virtual void SetCpuVec(const std::vector<uint32_t> &cpu_vec) = 0;
+
   virtual void Run() = 0;
 
   virtual void Stop() = 0;
 
   virtual Status Submit(FuncType func) = 0;
+
+  // queue to the worker key hashes to, tasks with the same key run on the
+  // same worker in submit order, unlike Submit it fails with ePoolFull
+  // rather than wait since no other worker drains that queue
+  virtual Status Submit(uint64_t key, FuncType func) = 0;
+
+  // like Submit but fail with ePoolFull instead of waiting for room, a
+  // refused func is dropped
+  virtual Status TrySubmit(FuncType func) = 0;
+
+  // queue into a scheduling lane, lane 0 is where Submit and TrySubmit
+  // without a lane go, an out of range lane means the last one
+  virtual Status TrySubmit(uint32_t lane, FuncType func) = 0;
+
+  // queue func_arr[0, func_num) into lane without waiting and wake the
+  // workers once, submit_num is how many were taken from the front of
+  // func_arr, ePoolFull when the lane could not take them all
+  virtual Status SubmitN(uint32_t lane, FuncType *func_arr, size_t func_num,
+                         size_t &submit_num) = 0;
+
+  virtual uint32_t GetLaneNum() const = 0;
+
+  // number of queued tasks not yet taken by a worker, keyed ones included
+  virtual size_t GetTaskNum() const = 0;
+
+  virtual size_t GetLaneTaskNum(uint32_t lane) const = 0;
+
+  // number of workers running a task
+  virtual uint32_t GetBusyNum() const = 0;
 };
 
 using PoolFactory = ClassFactory<Pool>;
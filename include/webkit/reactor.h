@@ -6,6 +6,7 @@
 #include "webkit/event.h"
 #include "webkit/socket.h"
 #include "webkit/status.h"
+#include "webkit/task.h"
 
 namespace webkit {
 class Reactor {
@@ -17,7 +18,17 @@ class Reactor {
   virtual std::shared_ptr<Event> CreateEvent(
       std::shared_ptr<Socket> socket_sp, std::shared_ptr<Packet> packet_sp) = 0;
 
+  // posted tasks run on the thread calling Wait, inside Wait
   virtual Status Wait(std::vector<Event *> &event_vec) = 0;
+
+  // queue task for the thread calling Wait and wake it, safe from any thread
+  virtual Status Post(Task task) = 0;
+
+  // make a blocked Wait return now, safe from any thread
+  virtual Status Wakeup() = 0;
+
+  // number of events currently registered
+  virtual size_t GetEventNum() const = 0;
 };
 
 using ReactorFactory = ClassFactory<Reactor>;
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "webkit/socket_option.h"
 
 namespace webkit {
 class ServerConfig {
@@ -11,14 +15,29 @@ class ServerConfig {
         log_path_(""),
         sock_timeout_sec_(2),
         epoller_max_event_(2000),
-        epoller_timeout_ms_(5),
+        epoller_timeout_ms_(-1),
+        epoller_busy_poll_us_(0),
+        sock_busy_poll_us_(0),
         is_epoll_event_et_(true),
         io_thread_num_(4),
         worker_thread_num_(8),
         worker_queue_size_(2000),
         max_connection_(2000),
         packet_max_size_(64UL << 20),
-        is_deamon_(false) {}
+        is_deamon_(false),
+        slow_request_threshold_us_(200000),
+        min_method_concurrency_(8),
+        max_method_concurrency_(1000),
+        default_method_lane_(0),
+        is_worker_affinity_(false),
+        is_numa_aware_(false),
+        drain_timeout_ms_(5000),
+        handoff_path_(""),
+        unix_path_(""),
+        shm_path_(""),
+        shm_ring_size_(1UL << 20),
+        zerocopy_threshold_(0),
+        worker_id_(-1) {}
 
   virtual ~ServerConfig() = default;
 
@@ -46,11 +65,28 @@ class ServerConfig {
   }
   bool IsEpollEventEt() const { return is_epoll_event_et_; }
 
+  // reactors are woken up for posted tasks and shutdown, so waits need no
+  // timeout, -1 blocks until an event arrives
   void SetEpollerTimeoutMs(int epoller_timeout_ms) {
     epoller_timeout_ms_ = epoller_timeout_ms;
   }
   int GetEpollerTimeoutMs() const { return epoller_timeout_ms_; }
 
+  // io threads keep polling without blocking for this long after a wait
+  // returned events, trading a busy core for wakeup latency, 0 disables it
+  void SetEpollerBusyPollUs(uint32_t epoller_busy_poll_us) {
+    epoller_busy_poll_us_ = epoller_busy_poll_us;
+  }
+  uint32_t GetEpollerBusyPollUs() const { return epoller_busy_poll_us_; }
+
+  // SO_BUSY_POLL and SO_PREFER_BUSY_POLL on accepted sockets, lets the
+  // kernel poll the nic queue instead of waiting for an interrupt, raising
+  // it above net.core.busy_read needs CAP_NET_ADMIN, 0 disables it
+  void SetSockBusyPollUs(int sock_busy_poll_us) {
+    sock_busy_poll_us_ = sock_busy_poll_us;
+  }
+  int GetSockBusyPollUs() const { return sock_busy_poll_us_; }
+
   void SetIoThreadNum(uint32_t io_thread_num) {
     io_thread_num_ = io_thread_num;
   }
@@ -79,6 +115,124 @@ class ServerConfig {
   }
   size_t GetPacketMaxSize() const { return packet_max_size_; }
 
+  // requests slower than the threshold are kept by the slow request
+  // recorder, 0 disables it
+  void SetSlowRequestThresholdUs(uint64_t slow_request_threshold_us) {
+    slow_request_threshold_us_ = slow_request_threshold_us;
+  }
+  uint64_t GetSlowRequestThresholdUs() const {
+    return slow_request_threshold_us_;
+  }
+
+  // bounds of the adaptive per method in-flight limit, requests over the
+  // limit are rejected with eServerOverloaded, a max of 0 disables it
+  void SetMinMethodConcurrency(uint32_t min_method_concurrency) {
+    min_method_concurrency_ = min_method_concurrency;
+  }
+  uint32_t GetMinMethodConcurrency() const { return min_method_concurrency_; }
+
+  void SetMaxMethodConcurrency(uint32_t max_method_concurrency) {
+    max_method_concurrency_ = max_method_concurrency;
+  }
+  uint32_t GetMaxMethodConcurrency() const { return max_method_concurrency_; }
+
+  // worker pool lane a method's requests are queued into, replies always go
+  // to lane 0 so it should be the most urgent one
+  void SetMethodLane(uint32_t method_id, uint32_t lane) {
+    method_lane_map_[method_id] = lane;
+  }
+  uint32_t GetMethodLane(uint32_t method_id) const {
+    auto iter = method_lane_map_.find(method_id);
+    if (iter == method_lane_map_.end()) return default_method_lane_;
+    return iter->second;
+  }
+
+  void SetDefaultMethodLane(uint32_t default_method_lane) {
+    default_method_lane_ = default_method_lane;
+  }
+  uint32_t GetDefaultMethodLane() const { return default_method_lane_; }
+
+  // run every request and reply of a connection on the worker its
+  // connection hashes to, keeping its event and packet in that worker's
+  // cache, method lanes are not used then
+  void SetWorkerAffinity(bool is_worker_affinity) {
+    is_worker_affinity_ = is_worker_affinity;
+  }
+  bool IsWorkerAffinity() const { return is_worker_affinity_; }
+
+  // io thread i runs on io_cpu_vec[i % size], worker i on
+  // worker_cpu_vec[i % size], empty leaves the threads unpinned
+  void SetIoCpuVec(const std::vector<uint32_t> &io_cpu_vec) {
+    io_cpu_vec_ = io_cpu_vec;
+  }
+  const std::vector<uint32_t> &GetIoCpuVec() const { return io_cpu_vec_; }
+
+  void SetWorkerCpuVec(const std::vector<uint32_t> &worker_cpu_vec) {
+    worker_cpu_vec_ = worker_cpu_vec;
+  }
+  const std::vector<uint32_t> &GetWorkerCpuVec() const {
+    return worker_cpu_vec_;
+  }
+
+  // io threads are spread over the numa nodes, each node gets its own
+  // worker pool of worker_thread_num threads on its cpus, and reactors,
+  // pools and connection state are allocated on their node, the cpu vecs
+  // above are ignored
+  void SetNumaAware(bool is_numa_aware) { is_numa_aware_ = is_numa_aware; }
+  bool IsNumaAware() const { return is_numa_aware_; }
+
+  // on stop, how long connections already accepted may take to get their
+  // replies before they are closed, 0 closes them at once
+  void SetDrainTimeoutMs(uint32_t drain_timeout_ms) {
+    drain_timeout_ms_ = drain_timeout_ms;
+  }
+  uint32_t GetDrainTimeoutMs() const { return drain_timeout_ms_; }
+
+  // unix socket path for hot restart, on start the server takes over the
+  // listening socket from the process serving the path instead of binding
+  // its own, then serves the path for its successor, empty disables it
+  void SetHandoffPath(const std::string &handoff_path) {
+    handoff_path_ = handoff_path;
+  }
+  const std::string &GetHandoffPath() const { return handoff_path_; }
+
+  // also accept on a unix socket at this path, for clients of the same user
+  // on the same host, see UnixChannel, empty serves tcp only
+  void SetUnixPath(const std::string &unix_path) { unix_path_ = unix_path; }
+  const std::string &GetUnixPath() const { return unix_path_; }
+
+  // also accept shm connections, handshaked over a unix socket at this
+  // path that only the same user may connect to, see ShmChannel, empty
+  // disables them
+  void SetShmPath(const std::string &shm_path) { shm_path_ = shm_path; }
+  const std::string &GetShmPath() const { return shm_path_; }
+
+  // bytes of each of the two rings of a shm connection, a larger message
+  // streams through the ring
+  void SetShmRingSize(size_t shm_ring_size) { shm_ring_size_ = shm_ring_size; }
+  size_t GetShmRingSize() const { return shm_ring_size_; }
+
+  // options of the tcp listening socket and of every accepted connection
+  void SetSocketOption(const SocketOption &socket_option) {
+    socket_option_ = socket_option;
+  }
+  const SocketOption &GetSocketOption() const { return socket_option_; }
+
+  // tcp replies send contiguous runs of at least this many bytes with
+  // MSG_ZEROCOPY, the connection is kept until the kernel reports them
+  // sent, pays off for bodies of several hundred KB and up, 0 disables it
+  void SetZeroCopyThreshold(size_t zerocopy_threshold) {
+    zerocopy_threshold_ = zerocopy_threshold;
+  }
+  size_t GetZeroCopyThreshold() const { return zerocopy_threshold_; }
+
+  // host id of the trace and span ids this process generates, below 1024
+  // and distinct among all processes serving at once, a successor taking
+  // over with handoff runs next to its predecessor and needs its own, -1
+  // derives it from ip and pid, which is unique only by chance
+  void SetWorkerId(int32_t worker_id) { worker_id_ = worker_id; }
+  int32_t GetWorkerId() const { return worker_id_; }
+
  protected:
   std::string ip_;
   uint16_t port_;
@@ -86,6 +240,8 @@ class ServerConfig {
   int sock_timeout_sec_;
   int epoller_max_event_;
   int epoller_timeout_ms_;
+  uint32_t epoller_busy_poll_us_;
+  int sock_busy_poll_us_;
   bool is_epoll_event_et_;
   uint32_t io_thread_num_;
   uint32_t worker_thread_num_;
@@ -93,5 +249,22 @@ class ServerConfig {
   uint32_t max_connection_;
   size_t packet_max_size_;
   bool is_deamon_;
+  uint64_t slow_request_threshold_us_;
+  uint32_t min_method_concurrency_;
+  uint32_t max_method_concurrency_;
+  uint32_t default_method_lane_;
+  std::unordered_map<uint32_t, uint32_t> method_lane_map_;
+  bool is_worker_affinity_;
+  std::vector<uint32_t> io_cpu_vec_;
+  std::vector<uint32_t> worker_cpu_vec_;
+  bool is_numa_aware_;
+  uint32_t drain_timeout_ms_;
+  std::string handoff_path_;
+  std::string unix_path_;
+  std::string shm_path_;
+  size_t shm_ring_size_;
+  SocketOption socket_option_;
+  size_t zerocopy_threshold_;
+  int32_t worker_id_;
 };
 }  // namespace webkit
\ No newline at end of file
@@ -17,5 +17,17 @@ class Socket : public IoBase {
   virtual Status Close() = 0;
 
   virtual int GetFd() const = 0;
+
+  // bracket the writes of one message, a socket may hold back partial
+  // segments in between, no-op by default
+  virtual void Cork(bool /*is_on*/) {}
+
+  // collect completions of zero copy sends, eRetry while the kernel still
+  // holds memory it was handed, which must not be freed or reused until OK
+  virtual Status ReapSend() { return Status::OK(); }
+
+  // room for a stalled write is signalled by the peer writing to the
+  // socket, so wait for it to turn readable rather than writable
+  virtual bool IsWriteWaitReadable() const { return false; }
 };
 }  // namespace webkit
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace webkit {
+// tcp socket options applied on listen, accept and connect, a value of 0
+// keeps the kernel default
+struct SocketOption {
+  // send small frames at once instead of holding them until the previous
+  // segment is acked, without it a reply written as header then body waits
+  // on the peer's delayed ack, up to 40 ms
+  bool is_nodelay = true;
+
+  // ack every segment right away, the kernel may fall back to delayed acks
+  // later so it only helps the first exchanges of a connection
+  bool is_quickack = false;
+
+  // cork the socket while a message is written and uncork it after, so the
+  // pieces of one message leave in full segments, costs two syscalls per
+  // message
+  bool is_cork = false;
+
+  int send_buffer_size = 0;
+  int recv_buffer_size = 0;
+
+  // listen only, wake the acceptor once the first data arrived, at most
+  // this many seconds after the handshake
+  int defer_accept_sec = 0;
+
+  // listen, length of the tcp fast open queue, connect, any value above 0
+  // sends the first request with the syn, both need net.ipv4.tcp_fastopen
+  int fastopen_queue_len = 0;
+
+  // drop the connection when sent data stays unacked this long
+  uint32_t user_timeout_ms = 0;
+
+  bool is_keepalive = false;
+  int keepalive_idle_sec = 0;
+  int keepalive_interval_sec = 0;
+  int keepalive_count = 0;
+
+  int listen_backlog = 1024;
+};
+}  // namespace webkit
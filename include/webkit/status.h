@@ -38,6 +38,9 @@ enum WebkitCode {
   eEpollWaitError = -304,
 
   eDisptachError = -401,
+  eDeadlineExceeded = -402,
+  // rejected by admission control before queueing, safe to retry
+  eServerOverloaded = -403,
 
   eCircularQueueEmpty = -501,
   eCircularQueueFull = -502,
@@ -47,6 +50,7 @@ enum WebkitCode {
   eEventRecvError = -602,
 
   ePoolStopped = -701,
+  ePoolFull = -702,
 
   eSerializeError = -801,
   eParseError = -802,
@@ -59,10 +63,15 @@ enum WebkitCode {
 
   ePacketFullError = -1101,
   ePacketSyncError = -1102,
+  ePacketFileError = -1103,
 
   eSyscallDeamonError = -1201,
   eThreadKeyError = -1202,
   eFcntlError = -1203,
+  eAffinityError = -1204,
+  eFdPassError = -1205,
+  eShmMapError = -1206,
+  eShmRingError = -1207,
 };
 }
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace webkit {
+// move only void() callable kept in inline storage, unlike std::function it
+// never allocates, a callable larger than kInlineSize fails to compile
+class Task {
+ public:
+  static constexpr size_t kInlineSize = 64;
+
+  Task() noexcept : invoke_(nullptr), relocate_(nullptr) {}
+
+  template <typename F,
+            typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+  Task(F &&func) {
+    using Func = std::decay_t<F>;
+    static_assert(sizeof(Func) <= kInlineSize,
+                  "task callable exceeds Task::kInlineSize, capture less");
+    static_assert(alignof(Func) <= alignof(std::max_align_t),
+                  "task callable is over aligned");
+    static_assert(std::is_nothrow_move_constructible_v<Func>,
+                  "task callable must be nothrow move constructible");
+    new (storage_) Func(std::forward<F>(func));
+    invoke_ = [](void *storage) { (*static_cast<Func *>(storage))(); };
+    relocate_ = [](void *dst, void *src) {
+      Func *src_func = static_cast<Func *>(src);
+      if (dst != nullptr) new (dst) Func(std::move(*src_func));
+      src_func->~Func();
+    };
+  }
+
+  Task(Task &&other) noexcept : invoke_(nullptr), relocate_(nullptr) {
+    MoveFrom(other);
+  }
+
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+
+  Task(const Task &) = delete;
+
+  Task &operator=(const Task &) = delete;
+
+  ~Task() { Reset(); }
+
+  void operator()() { invoke_(storage_); }
+
+  explicit operator bool() const { return invoke_ != nullptr; }
+
+  void Reset() {
+    if (relocate_ != nullptr) relocate_(nullptr, storage_);
+    invoke_ = nullptr;
+    relocate_ = nullptr;
+  }
+
+ private:
+  void MoveFrom(Task &other) {
+    if (other.relocate_ == nullptr) return;
+    other.relocate_(storage_, other.storage_);
+    invoke_ = other.invoke_;
+    relocate_ = other.relocate_;
+    other.invoke_ = nullptr;
+    other.relocate_ = nullptr;
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  void (*invoke_)(void *storage);
+  // move construct into dst when it is not null, then destroy src
+  void (*relocate_)(void *dst, void *src);
+};
+}  // namespace webkit
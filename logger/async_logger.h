@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+
+#include "logger/callback_logger.h"
+#include "logger/log_writer.h"
+
+namespace webkit {
+class AsyncLogger : public CallbackLogger {
+ public:
+  using FullPolicy = AsyncLogWriter::FullPolicy;
+
+  using Option = AsyncLogWriter::Option;
+
+ private:
+  AsyncLogger(int fd, bool is_own_fd, const Option &option,
+              CallbackType prefix_cb, CallbackType suffix_cb)
+      : CallbackLogger(prefix_cb, suffix_cb),
+        writer_(fd, is_own_fd, option) {}
+
+ public:
+  ~AsyncLogger() = default;
+
+  static std::unique_ptr<AsyncLogger> Open(
+      const std::string &path, const Option &option = Option(),
+      CallbackType prefix_cb = DefaultPrefixCallback,
+      CallbackType suffix_cb = DefaultSuffixCallback) {
+    int fd = AsyncLogWriter::OpenFile(path);
+    if (fd < 0) return nullptr;
+    return std::unique_ptr<AsyncLogger>(
+        new AsyncLogger(fd, true, option, prefix_cb, suffix_cb));
+  }
+
+  static std::unique_ptr<AsyncLogger> Attach(
+      int fd, const Option &option = Option(),
+      CallbackType prefix_cb = DefaultPrefixCallback,
+      CallbackType suffix_cb = DefaultSuffixCallback) {
+    return std::unique_ptr<AsyncLogger>(
+        new AsyncLogger(fd, false, option, prefix_cb, suffix_cb));
+  }
+
+  void Log(Level level, const std::string &message) override {
+    if (!IsLogEnable(level)) return;
+    writer_.Push(message.data(), message.length());
+  }
+
+  void Flush() override { writer_.Flush(); }
+
+  uint64_t GetDropCount() const override { return writer_.GetDropCount(); }
+
+ private:
+  AsyncLogWriter writer_;
+};
+}  // namespace webkit
@@ -0,0 +1,80 @@
+#include "binary_logger.h"
+
+#include <mutex>
+#include <vector>
+
+namespace webkit {
+static std::mutex LogSiteMutex;
+static std::vector<const LogSite *> LogSiteVec;
+
+uint32_t BinaryLogger::RegisterSite(const LogSite *site) {
+  std::lock_guard<std::mutex> lg(LogSiteMutex);
+  LogSiteVec.push_back(site);
+  return static_cast<uint32_t>(LogSiteVec.size() - 1);
+}
+
+size_t BinaryLogger::GetSiteNum() {
+  std::lock_guard<std::mutex> lg(LogSiteMutex);
+  return LogSiteVec.size();
+}
+
+const LogSite *BinaryLogger::GetSite(uint32_t site_id) {
+  std::lock_guard<std::mutex> lg(LogSiteMutex);
+  if (site_id >= LogSiteVec.size()) return nullptr;
+  return LogSiteVec[site_id];
+}
+
+AsyncBinaryLogger::AsyncBinaryLogger(int fd, const Option &option)
+    : is_magic_written_(false),
+      written_site_num_(0),
+      writer_(fd, true, option,
+              [this](std::string &prologue) { WritePrologue(prologue); }) {}
+
+std::unique_ptr<AsyncBinaryLogger> AsyncBinaryLogger::Open(
+    const std::string &path, const Option &option) {
+  int fd = AsyncLogWriter::OpenFile(path);
+  if (fd < 0) return nullptr;
+  return std::unique_ptr<AsyncBinaryLogger>(new AsyncBinaryLogger(fd, option));
+}
+
+void AsyncBinaryLogger::Write(const void *record, size_t size) {
+  writer_.Push(record, size);
+}
+
+void AsyncBinaryLogger::Flush() { writer_.Flush(); }
+
+uint64_t AsyncBinaryLogger::GetDropCount() const {
+  return writer_.GetDropCount();
+}
+
+void AsyncBinaryLogger::WritePrologue(std::string &prologue) {
+  auto append = [&](const void *data, size_t size) {
+    prologue.append(reinterpret_cast<const char *>(data), size);
+  };
+  auto append_string = [&](const char *str) {
+    uint32_t len = static_cast<uint32_t>(strlen(str));
+    append(&len, sizeof(len));
+    append(str, len);
+  };
+
+  if (!is_magic_written_) {
+    append(kMagic, sizeof(kMagic));
+    is_magic_written_ = true;
+  }
+  size_t site_num = GetSiteNum();
+  for (; written_site_num_ < site_num; written_site_num_++) {
+    const LogSite *site = GetSite(static_cast<uint32_t>(written_site_num_));
+    uint8_t type = eRecordSite;
+    uint32_t site_id = static_cast<uint32_t>(written_site_num_);
+    uint8_t level = static_cast<uint8_t>(site->level);
+    uint32_t line = static_cast<uint32_t>(site->line);
+    append(&type, sizeof(type));
+    append(&site_id, sizeof(site_id));
+    append(&level, sizeof(level));
+    append(&line, sizeof(line));
+    append_string(site->file);
+    append_string(site->func);
+    append_string(site->format);
+  }
+}
+}  // namespace webkit
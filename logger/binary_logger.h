@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include "logger/log_writer.h"
+#include "webkit/binary_logger.h"
+
+namespace webkit {
+// buffers binary records per thread and appends them to a file, site records
+// are emitted by the flusher right before the first batch that needs them
+class AsyncBinaryLogger : public BinaryLogger {
+ public:
+  using Option = AsyncLogWriter::Option;
+
+ private:
+  AsyncBinaryLogger(int fd, const Option &option);
+
+ public:
+  ~AsyncBinaryLogger() = default;
+
+  static std::unique_ptr<AsyncBinaryLogger> Open(
+      const std::string &path, const Option &option = Option());
+
+  void Write(const void *record, size_t size) override;
+
+  void Flush() override;
+
+  uint64_t GetDropCount() const override;
+
+ private:
+  void WritePrologue(std::string &prologue);
+
+  bool is_magic_written_;
+  size_t written_site_num_;
+  AsyncLogWriter writer_;
+};
+}  // namespace webkit
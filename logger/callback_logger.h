@@ -2,7 +2,8 @@
 
 #include <functional>
 
-#include "util/time.h"
+#include "util/coarse_clock.h"
+#include "util/generator.h"
 #include "util/trace_helper.h"
 #include "webkit/logger.h"
 
@@ -13,17 +14,39 @@ class CallbackLogger : public Logger {
 
   CallbackLogger(CallbackType prefix_cb = DefaultPrefixCallback,
                  CallbackType suffix_cb = DefaultSuffixCallback)
-      : prefix_cb_(prefix_cb), suffix_cb_(suffix_cb) {}
+      : prefix_cb_(prefix_cb), suffix_cb_(suffix_cb) {
+    auto *p_prefix_func = prefix_cb_.target<std::string (*)()>();
+    is_default_prefix_ = p_prefix_func != nullptr &&
+                         *p_prefix_func == &CallbackLogger::DefaultPrefixCallback;
+  }
 
   ~CallbackLogger() = default;
 
+  virtual size_t FormatPrefix(char *buf, size_t size) override {
+    if (is_default_prefix_) return FormatDefaultPrefix(buf, size);
+    return Logger::FormatPrefix(buf, size);
+  }
+
   virtual std::string GetPrefix() override { return prefix_cb_(); }
 
   virtual std::string GetSuffix() override { return suffix_cb_(); }
 
+  // "<time> <trace id> "
+  static size_t FormatDefaultPrefix(char *buf, size_t size) {
+    size_t pos = CoarseClock::GetInstance()->FormatNow(buf, size);
+    uint64_t trace_id = TraceHelper::GetInstance()->GetTraceId();
+    if (pos + UidGenerator::kHexSize + 2 > size) return pos;
+    buf[pos++] = ' ';
+    if (trace_id != 0) {
+      pos += UidGenerator::ToHex(trace_id, buf + pos, size - pos);
+    }
+    buf[pos++] = ' ';
+    return pos;
+  }
+
   static std::string DefaultPrefixCallback() {
-    return Time::GetNowTimeStr() + " " +
-           TraceHelper::GetInstance()->GetTraceId() + " ";
+    char buf[kMaxPrefixSize];
+    return std::string(buf, FormatDefaultPrefix(buf, sizeof(buf)));
   }
 
   static std::string DefaultSuffixCallback() { return ""; }
@@ -31,5 +54,6 @@ class CallbackLogger : public Logger {
  private:
   CallbackType prefix_cb_;
   CallbackType suffix_cb_;
+  bool is_default_prefix_;
 };
 }  // namespace webkit
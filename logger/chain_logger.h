@@ -2,10 +2,11 @@
 
 #include <vector>
 
-#include "webkit/logger.h"
+#include "logger/callback_logger.h"
 
 namespace webkit {
-class ChainLogger : public Logger {
+// format message with prefix once and pass it to every logger in the chain
+class ChainLogger : public CallbackLogger {
  public:
   template <typename... Args>
   ChainLogger(Args... args) {
@@ -22,7 +23,17 @@ class ChainLogger : public Logger {
 
   void Log(Level level, const std::string &message) override {
     if (!IsLogEnable(level)) return;
-    for (Logger *logger : logger_vec_) logger->LogF(level, message);
+    for (Logger *logger : logger_vec_) logger->Log(level, message);
+  }
+
+  void Flush() override {
+    for (Logger *logger : logger_vec_) logger->Flush();
+  }
+
+  uint64_t GetDropCount() const override {
+    uint64_t drop_count = 0;
+    for (Logger *logger : logger_vec_) drop_count += logger->GetDropCount();
+    return drop_count;
   }
 
  private:
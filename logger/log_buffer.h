@@ -0,0 +1,80 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace webkit {
+// single producer single consumer byte ring, the producer is the logging
+// thread and the consumer is the flusher thread
+class LogBuffer {
+ public:
+  LogBuffer(size_t capacity) : head_(0), tail_(0) {
+    capacity_ = 1;
+    while (capacity_ < capacity) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    buffer_ = new char[capacity_];
+  }
+
+  ~LogBuffer() { delete[] buffer_; }
+
+  LogBuffer(const LogBuffer &) = delete;
+
+  LogBuffer &operator=(const LogBuffer &) = delete;
+
+  bool Push(const void *data, size_t size) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    if (capacity_ - (tail - head) < size) return false;
+    size_t pos = tail & mask_;
+    size_t tail_size = std::min(size, capacity_ - pos);
+    memcpy(buffer_ + pos, data, tail_size);
+    memcpy(buffer_, reinterpret_cast<const char *>(data) + tail_size,
+           size - tail_size);
+    tail_.store(tail + size, std::memory_order_release);
+    return true;
+  }
+
+  // fill at most two iovec with no more than max_size readable bytes,
+  // return the peeked size
+  size_t Peek(struct iovec *iov, int &iov_num, size_t max_size) const {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t size = std::min(tail - head, max_size);
+    iov_num = 0;
+    if (size == 0) return 0;
+    size_t pos = head & mask_;
+    size_t tail_size = std::min(size, capacity_ - pos);
+    iov[iov_num].iov_base = buffer_ + pos;
+    iov[iov_num].iov_len = tail_size;
+    iov_num++;
+    if (tail_size < size) {
+      iov[iov_num].iov_base = buffer_;
+      iov[iov_num].iov_len = size - tail_size;
+      iov_num++;
+    }
+    return size;
+  }
+
+  void Pop(size_t size) {
+    head_.store(head_.load(std::memory_order_relaxed) + size,
+                std::memory_order_release);
+  }
+
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  size_t Capacity() const { return capacity_; }
+
+ private:
+  char *buffer_;
+  size_t capacity_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+};
+}  // namespace webkit
@@ -0,0 +1,199 @@
+#include "log_writer.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace webkit {
+static std::atomic<uint64_t> AsyncLogWriterId{1};
+
+AsyncLogWriter::AsyncLogWriter(int fd, bool is_own_fd, const Option &option,
+                               PrologueCallback prologue_cb)
+    : fd_(fd),
+      is_own_fd_(is_own_fd),
+      option_(option),
+      prologue_cb_(prologue_cb),
+      id_(AsyncLogWriterId.fetch_add(1, std::memory_order_relaxed)),
+      flush_request_(0),
+      flush_done_(0),
+      is_notified_(false),
+      is_running_(true),
+      drop_count_(0) {
+  flush_thread_ = std::thread([this] { RunFlush(); });
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  {
+    std::lock_guard<std::mutex> lg(flush_mutex_);
+    is_running_ = false;
+  }
+  flush_cv_.notify_one();
+  flush_thread_.join();
+  if (is_own_fd_ && fd_ >= 0) close(fd_);
+}
+
+int AsyncLogWriter::OpenFile(const std::string &path) {
+  constexpr mode_t mode =
+      S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
+  {
+    const char *end = strrchr(path.c_str(), '/');
+    if (end != nullptr) {
+      std::string dir(path.c_str(), end);
+      if (access(dir.c_str(), F_OK) != 0) {
+        mkdir(dir.c_str(), mode);
+      }
+    }
+  }
+  return open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, mode);
+}
+
+void AsyncLogWriter::Push(const void *data, size_t size) {
+  LogBuffer *buffer = GetThreadBuffer();
+  if (size > buffer->Capacity()) {
+    drop_count_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  while (!buffer->Push(data, size)) {
+    if (option_.full_policy == eDrop) {
+      drop_count_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    Notify();
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  if (buffer->Size() >= buffer->Capacity() / 2) Notify();
+}
+
+void AsyncLogWriter::Flush() {
+  std::unique_lock<std::mutex> ul(flush_mutex_);
+  if (!is_running_) return;
+  uint64_t request = ++flush_request_;
+  flush_cv_.notify_one();
+  flush_done_cv_.wait(ul,
+                      [&] { return flush_done_ >= request || !is_running_; });
+}
+
+uint64_t AsyncLogWriter::GetDropCount() const {
+  return drop_count_.load(std::memory_order_relaxed);
+}
+
+void AsyncLogWriter::Notify() {
+  if (is_notified_.exchange(true, std::memory_order_acq_rel)) return;
+  flush_cv_.notify_one();
+}
+
+LogBuffer *AsyncLogWriter::GetThreadBuffer() {
+  // keyed by logger id rather than address so a new logger never picks up
+  // a buffer owned by a destroyed one
+  static thread_local std::vector<std::pair<uint64_t, LogBuffer *>>
+      buffer_cache;
+  for (const auto &item : buffer_cache) {
+    if (item.first == id_) return item.second;
+  }
+  auto buffer_up = std::make_unique<LogBuffer>(option_.buffer_size);
+  LogBuffer *buffer = buffer_up.get();
+  {
+    std::lock_guard<std::mutex> lg(buffer_mutex_);
+    buffer_vec_.push_back(std::move(buffer_up));
+  }
+  buffer_cache.emplace_back(id_, buffer);
+  return buffer;
+}
+
+void AsyncLogWriter::RunFlush() {
+  while (true) {
+    uint64_t request = 0;
+    bool is_running = true;
+    {
+      std::unique_lock<std::mutex> ul(flush_mutex_);
+      flush_cv_.wait_for(
+          ul, std::chrono::milliseconds(option_.flush_interval_ms), [&] {
+            return !is_running_ || flush_request_ != flush_done_ ||
+                   is_notified_.load(std::memory_order_acquire);
+          });
+      request = flush_request_;
+      is_running = is_running_;
+      is_notified_.store(false, std::memory_order_release);
+    }
+
+    FlushBuffers();
+
+    {
+      std::lock_guard<std::mutex> lg(flush_mutex_);
+      flush_done_ = request;
+    }
+    flush_done_cv_.notify_all();
+    if (!is_running) break;
+  }
+}
+
+void AsyncLogWriter::FlushBuffers() {
+  std::vector<LogBuffer *> buffer_vec;
+  {
+    std::lock_guard<std::mutex> lg(buffer_mutex_);
+    for (const auto &buffer_up : buffer_vec_) {
+      buffer_vec.push_back(buffer_up.get());
+    }
+  }
+
+  static constexpr int kMaxIovNum = IOV_MAX;
+  struct iovec iov[kMaxIovNum];
+  std::vector<std::pair<LogBuffer *, size_t>> pop_vec;
+  int iov_num = 0;
+
+  // peek every ring before building the prologue, so the prologue covers
+  // whatever the records in this batch refer to
+  prologue_.clear();
+  std::vector<std::pair<LogBuffer *, size_t>> peek_vec;
+  for (LogBuffer *buffer : buffer_vec) {
+    peek_vec.emplace_back(buffer, buffer->Size());
+  }
+  if (prologue_cb_ != nullptr) prologue_cb_(prologue_);
+  if (!prologue_.empty()) {
+    iov[iov_num].iov_base = &prologue_[0];
+    iov[iov_num].iov_len = prologue_.length();
+    iov_num++;
+  }
+  for (const auto &peek : peek_vec) {
+    LogBuffer *buffer = peek.first;
+    if (iov_num + 2 > kMaxIovNum) {
+      WriteAll(iov, iov_num);
+      for (const auto &item : pop_vec) item.first->Pop(item.second);
+      pop_vec.clear();
+      iov_num = 0;
+    }
+    int buffer_iov_num = 0;
+    size_t size = buffer->Peek(&iov[iov_num], buffer_iov_num, peek.second);
+    if (size == 0) continue;
+    iov_num += buffer_iov_num;
+    pop_vec.emplace_back(buffer, size);
+  }
+  if (iov_num == 0) return;
+  WriteAll(iov, iov_num);
+  for (const auto &item : pop_vec) item.first->Pop(item.second);
+}
+
+void AsyncLogWriter::WriteAll(struct iovec *iov, int iov_num) {
+  while (iov_num > 0) {
+    ssize_t nwrite = writev(fd_, iov, iov_num);
+    if (nwrite < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    size_t write_size = static_cast<size_t>(nwrite);
+    while (iov_num > 0 && write_size >= iov->iov_len) {
+      write_size -= iov->iov_len;
+      iov++;
+      iov_num--;
+    }
+    if (iov_num > 0) {
+      iov->iov_base = reinterpret_cast<char *>(iov->iov_base) + write_size;
+      iov->iov_len -= write_size;
+    }
+  }
+}
+}  // namespace webkit
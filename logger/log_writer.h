@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger/log_buffer.h"
+
+namespace webkit {
+// collects log records from per-thread rings and writes them to fd in large
+// writev batches on a background thread
+class AsyncLogWriter {
+ public:
+  enum FullPolicy {
+    eDrop = 0,
+    eBlock = 1,
+  };
+
+  struct Option {
+    Option()
+        : full_policy(eDrop), buffer_size(1UL << 20), flush_interval_ms(10) {}
+
+    FullPolicy full_policy;
+    size_t buffer_size;  // per thread
+    int flush_interval_ms;
+  };
+
+  // called on the flusher thread before each batch, anything appended to
+  // prologue is written ahead of the batch
+  using PrologueCallback = std::function<void(std::string &prologue)>;
+
+  AsyncLogWriter(int fd, bool is_own_fd, const Option &option,
+                 PrologueCallback prologue_cb = nullptr);
+
+  ~AsyncLogWriter();
+
+  AsyncLogWriter(const AsyncLogWriter &) = delete;
+
+  AsyncLogWriter &operator=(const AsyncLogWriter &) = delete;
+
+  static int OpenFile(const std::string &path);
+
+  void Push(const void *data, size_t size);
+
+  void Flush();
+
+  uint64_t GetDropCount() const;
+
+ private:
+  void Notify();
+
+  LogBuffer *GetThreadBuffer();
+
+  void RunFlush();
+
+  void FlushBuffers();
+
+  void WriteAll(struct iovec *iov, int iov_num);
+
+  int fd_;
+  bool is_own_fd_;
+  Option option_;
+  PrologueCallback prologue_cb_;
+  uint64_t id_;
+
+  std::mutex buffer_mutex_;
+  std::vector<std::unique_ptr<LogBuffer>> buffer_vec_;
+
+  std::mutex flush_mutex_;
+  std::condition_variable flush_cv_;
+  std::condition_variable flush_done_cv_;
+  uint64_t flush_request_;
+  uint64_t flush_done_;
+  std::atomic<bool> is_notified_;
+  bool is_running_;
+  std::thread flush_thread_;
+
+  std::string prologue_;
+  std::atomic<uint64_t> drop_count_;
+};
+}  // namespace webkit
@@ -0,0 +1,237 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "third_party/fmt/include/fmt/printf.h"
+#include "util/coarse_clock.h"
+
+namespace webkit {
+static std::atomic<size_t> MetricsShardSeq{0};
+
+size_t GetMetricsShardIndex() {
+  static thread_local size_t shard_index =
+      MetricsShardSeq.fetch_add(1, std::memory_order_relaxed) %
+      kMetricsShardNum;
+  return shard_index;
+}
+
+Counter::Counter() {
+  for (Shard &shard : shard_arr_) shard.value = 0;
+}
+
+int64_t Counter::Value() const {
+  int64_t value = 0;
+  for (const Shard &shard : shard_arr_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+Gauge::Gauge() {
+  for (Shard &shard : shard_arr_) shard.value = 0;
+}
+
+int64_t Gauge::Value() const {
+  int64_t value = 0;
+  for (const Shard &shard : shard_arr_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+HistogramSnapshot::HistogramSnapshot()
+    : bucket_vec_(Histogram::kBucketNum, 0), count_(0), sum_(0), max_(0) {}
+
+void HistogramSnapshot::Merge(const HistogramSnapshot &other) {
+  for (size_t i = 0; i < bucket_vec_.size(); i++) {
+    bucket_vec_[i] += other.bucket_vec_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+void HistogramSnapshot::Subtract(const HistogramSnapshot &other) {
+  for (size_t i = 0; i < bucket_vec_.size(); i++) {
+    bucket_vec_[i] -= std::min(bucket_vec_[i], other.bucket_vec_[i]);
+  }
+  count_ -= std::min(count_, other.count_);
+  sum_ -= std::min(sum_, other.sum_);
+}
+
+uint64_t HistogramSnapshot::Percentile(double quantile) const {
+  if (count_ == 0) return 0;
+  quantile = std::min(std::max(quantile, 0.0), 1.0);
+  uint64_t rank = static_cast<uint64_t>(quantile * count_ + 0.5);
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < bucket_vec_.size(); i++) {
+    seen += bucket_vec_[i];
+    if (seen >= rank) {
+      // report the bucket upper bound, never above the recorded max
+      uint64_t upper = i + 1 < Histogram::kBucketNum
+                           ? Histogram::BucketLowerBound(i + 1) - 1
+                           : max_;
+      return std::min(upper, max_);
+    }
+  }
+  return max_;
+}
+
+double HistogramSnapshot::Mean() const {
+  if (count_ == 0) return 0;
+  return static_cast<double>(sum_) / count_;
+}
+
+std::string HistogramSnapshot::ToString() const {
+  return fmt::sprintf("count %lu mean %.1f p50 %lu p99 %lu p999 %lu max %lu",
+                      count_, Mean(), Percentile(0.5), Percentile(0.99),
+                      Percentile(0.999), max_);
+}
+
+Histogram::Histogram() : shard_arr_(new Shard[kMetricsShardNum]) {
+  for (size_t i = 0; i < kMetricsShardNum; i++) {
+    Shard &shard = shard_arr_[i];
+    for (auto &bucket : shard.bucket_arr) bucket = 0;
+    shard.count = 0;
+    shard.sum = 0;
+    shard.max = 0;
+  }
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  for (size_t i = 0; i < kMetricsShardNum; i++) {
+    const Shard &shard = shard_arr_[i];
+    for (uint32_t j = 0; j < kBucketNum; j++) {
+      snapshot.bucket_vec_[j] +=
+          shard.bucket_arr[j].load(std::memory_order_relaxed);
+    }
+    snapshot.count_ += shard.count.load(std::memory_order_relaxed);
+    snapshot.sum_ += shard.sum.load(std::memory_order_relaxed);
+    snapshot.max_ =
+        std::max(snapshot.max_, shard.max.load(std::memory_order_relaxed));
+  }
+  return snapshot;
+}
+
+uint32_t Histogram::BucketIndex(uint64_t value) {
+  if (value < kSubBucketNum) return static_cast<uint32_t>(value);
+  uint32_t exp = 63 - __builtin_clzll(value);
+  if (exp >= kMaxValueBits) return kBucketNum - 1;
+  uint32_t sub = static_cast<uint32_t>(value >> (exp - kSubBucketBits)) &
+                 (kSubBucketNum - 1);
+  return kSubBucketNum + (exp - kSubBucketBits) * kSubBucketNum + sub;
+}
+
+uint64_t Histogram::BucketLowerBound(uint32_t index) {
+  if (index < kSubBucketNum) return index;
+  uint32_t exp = (index - kSubBucketNum) / kSubBucketNum + kSubBucketBits;
+  uint64_t sub = (index - kSubBucketNum) % kSubBucketNum;
+  return (kSubBucketNum + sub) << (exp - kSubBucketBits);
+}
+
+void MetricsSnapshot::Merge(const MetricsSnapshot &other) {
+  timestamp_ms = std::max(timestamp_ms, other.timestamp_ms);
+  for (const auto &item : other.counter_map) {
+    counter_map[item.first] += item.second;
+  }
+  for (const auto &item : other.gauge_map) {
+    gauge_map[item.first] += item.second;
+  }
+  for (const auto &item : other.histogram_map) {
+    histogram_map[item.first].Merge(item.second);
+  }
+}
+
+MetricsSnapshot MetricsSnapshot::Delta(const MetricsSnapshot &prev) const {
+  MetricsSnapshot delta = *this;
+  for (auto &item : delta.counter_map) {
+    auto iter = prev.counter_map.find(item.first);
+    if (iter != prev.counter_map.end()) item.second -= iter->second;
+  }
+  for (auto &item : delta.histogram_map) {
+    auto iter = prev.histogram_map.find(item.first);
+    if (iter != prev.histogram_map.end()) item.second.Subtract(iter->second);
+  }
+  return delta;
+}
+
+std::string MetricsSnapshot::ToString() const {
+  std::string str;
+  for (const auto &item : counter_map) {
+    str += fmt::sprintf("%s %ld\n", item.first, item.second);
+  }
+  for (const auto &item : gauge_map) {
+    str += fmt::sprintf("%s %ld\n", item.first, item.second);
+  }
+  for (const auto &item : histogram_map) {
+    str += fmt::sprintf("%s %s\n", item.first, item.second.ToString());
+  }
+  return str;
+}
+
+Counter *MetricsRegistry::GetCounter(const std::string &name) {
+  std::lock_guard<std::mutex> lg(mutex_);
+  std::unique_ptr<Counter> &counter_up = counter_map_[name];
+  if (counter_up == nullptr) counter_up = std::make_unique<Counter>();
+  return counter_up.get();
+}
+
+Gauge *MetricsRegistry::GetGauge(const std::string &name) {
+  std::lock_guard<std::mutex> lg(mutex_);
+  std::unique_ptr<Gauge> &gauge_up = gauge_map_[name];
+  if (gauge_up == nullptr) gauge_up = std::make_unique<Gauge>();
+  return gauge_up.get();
+}
+
+Histogram *MetricsRegistry::GetHistogram(const std::string &name) {
+  std::lock_guard<std::mutex> lg(mutex_);
+  std::unique_ptr<Histogram> &histogram_up = histogram_map_[name];
+  if (histogram_up == nullptr) histogram_up = std::make_unique<Histogram>();
+  return histogram_up.get();
+}
+
+const MethodMetrics &MetricsRegistry::GetMethodMetrics(uint32_t method_id) {
+  static thread_local std::unordered_map<uint32_t, const MethodMetrics *>
+      method_cache;
+  auto iter = method_cache.find(method_id);
+  if (iter != method_cache.end()) return *iter->second;
+
+  auto method_up = std::make_unique<MethodMetrics>();
+  method_up->request = GetCounter(fmt::sprintf("method.%u.request", method_id));
+  method_up->error = GetCounter(fmt::sprintf("method.%u.error", method_id));
+  method_up->latency_us =
+      GetHistogram(fmt::sprintf("method.%u.latency_us", method_id));
+
+  std::lock_guard<std::mutex> lg(mutex_);
+  std::unique_ptr<MethodMetrics> &metrics_up = method_map_[method_id];
+  if (metrics_up == nullptr) metrics_up = std::move(method_up);
+  method_cache[method_id] = metrics_up.get();
+  return *metrics_up;
+}
+
+const MethodMetrics &MetricsRegistry::GetUnknownMethodMetrics() {
+  static const MethodMetrics unknown_metrics{
+      GetCounter("method.unknown.request"), GetCounter("method.unknown.error"),
+      GetHistogram("method.unknown.latency_us")};
+  return unknown_metrics;
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() {
+  MetricsSnapshot snapshot;
+  snapshot.timestamp_ms = CoarseClock::GetInstance()->NowMs();
+  std::lock_guard<std::mutex> lg(mutex_);
+  for (const auto &item : counter_map_) {
+    snapshot.counter_map[item.first] = item.second->Value();
+  }
+  for (const auto &item : gauge_map_) {
+    snapshot.gauge_map[item.first] = item.second->Value();
+  }
+  for (const auto &item : histogram_map_) {
+    snapshot.histogram_map[item.first] = item.second->Snapshot();
+  }
+  return snapshot;
+}
+}  // namespace webkit
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace webkit {
+// every metric is split into kShardNum cache line aligned shards, a thread
+// always records into the same shard so recording is a relaxed atomic add
+// on a line that is rarely shared
+static constexpr size_t kMetricsShardNum = 16;
+
+size_t GetMetricsShardIndex();
+
+class Counter {
+ public:
+  Counter();
+
+  void Add(int64_t value = 1) {
+    shard_arr_[GetMetricsShardIndex()].value.fetch_add(
+        value, std::memory_order_relaxed);
+  }
+
+  int64_t Value() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value;
+  };
+
+  Shard shard_arr_[kMetricsShardNum];
+};
+
+// gauge only supports relative updates, so it can be sharded like counter
+class Gauge {
+ public:
+  Gauge();
+
+  void Add(int64_t value) {
+    shard_arr_[GetMetricsShardIndex()].value.fetch_add(
+        value, std::memory_order_relaxed);
+  }
+
+  void Sub(int64_t value) { Add(-value); }
+
+  int64_t Value() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value;
+  };
+
+  Shard shard_arr_[kMetricsShardNum];
+};
+
+class HistogramSnapshot {
+ public:
+  HistogramSnapshot();
+
+  void Merge(const HistogramSnapshot &other);
+
+  // remove an earlier snapshot of the same histogram, leaves the samples
+  // recorded in between, max is kept as is
+  void Subtract(const HistogramSnapshot &other);
+
+  // value at quantile, quantile is in [0, 1]
+  uint64_t Percentile(double quantile) const;
+
+  double Mean() const;
+
+  uint64_t Count() const { return count_; }
+
+  uint64_t Sum() const { return sum_; }
+
+  uint64_t Max() const { return max_; }
+
+  std::string ToString() const;
+
+ private:
+  friend class Histogram;
+
+  std::vector<uint64_t> bucket_vec_;
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t max_;
+};
+
+// log-linear buckets, every power of two range is split into
+// kSubBucketNum linear buckets, so the relative error is below
+// 1 / kSubBucketNum
+class Histogram {
+ public:
+  static constexpr uint32_t kSubBucketBits = 4;
+  static constexpr uint32_t kSubBucketNum = 1U << kSubBucketBits;
+  static constexpr uint32_t kMaxValueBits = 40;
+  static constexpr uint32_t kBucketNum =
+      kSubBucketNum + (kMaxValueBits - kSubBucketBits) * kSubBucketNum;
+
+  Histogram();
+
+  void Record(uint64_t value) {
+    Shard &shard = shard_arr_[GetMetricsShardIndex()];
+    shard.bucket_arr[BucketIndex(value)].fetch_add(1,
+                                                   std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = shard.max.load(std::memory_order_relaxed);
+    while (value > max && !shard.max.compare_exchange_weak(
+                              max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  HistogramSnapshot Snapshot() const;
+
+  static uint32_t BucketIndex(uint64_t value);
+
+  // smallest value that falls into bucket
+  static uint64_t BucketLowerBound(uint32_t index);
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> bucket_arr[kBucketNum];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+  };
+
+  std::unique_ptr<Shard[]> shard_arr_;
+};
+
+struct MetricsSnapshot {
+  MetricsSnapshot() : timestamp_ms(0) {}
+
+  uint64_t timestamp_ms;
+  std::map<std::string, int64_t> counter_map;
+  std::map<std::string, int64_t> gauge_map;
+  std::map<std::string, HistogramSnapshot> histogram_map;
+
+  // sum counters and gauges, merge histograms, used to combine snapshots of
+  // several processes
+  void Merge(const MetricsSnapshot &other);
+
+  // counters and histograms recorded since prev, divide counters by
+  // the elapsed time to get rates such as qps
+  MetricsSnapshot Delta(const MetricsSnapshot &prev) const;
+
+  // "name value" per line, histograms as count/mean/p50/p99/p999/max
+  std::string ToString() const;
+};
+
+struct MethodMetrics {
+  Counter *request;
+  Counter *error;
+  Histogram *latency_us;
+};
+
+class MetricsRegistry {
+ private:
+  MetricsRegistry() = default;
+
+ public:
+  ~MetricsRegistry() = default;
+
+  static MetricsRegistry *GetInstance() {
+    static MetricsRegistry instance;
+    return &instance;
+  }
+
+  // returned pointers stay valid for the lifetime of the process, callers
+  // on the hot path should look them up once and keep them
+  Counter *GetCounter(const std::string &name);
+
+  Gauge *GetGauge(const std::string &name);
+
+  Histogram *GetHistogram(const std::string &name);
+
+  // "method.<method_id>.request|error|latency_us", cached per thread, only
+  // for method ids a dispatcher has, each one is kept for good
+  const MethodMetrics &GetMethodMetrics(uint32_t method_id);
+
+  // "method.unknown.request|error|latency_us", shared by every other id
+  const MethodMetrics &GetUnknownMethodMetrics();
+
+  MetricsSnapshot Snapshot();
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Counter>> counter_map_;
+  std::map<std::string, std::unique_ptr<Gauge>> gauge_map_;
+  std::map<std::string, std::unique_ptr<Histogram>> histogram_map_;
+  std::map<uint32_t, std::unique_ptr<MethodMetrics>> method_map_;
+};
+}  // namespace webkit
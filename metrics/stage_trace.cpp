@@ -0,0 +1,100 @@
+#include "stage_trace.h"
+
+#include <algorithm>
+
+#include "metrics/metrics.h"
+#include "third_party/fmt/include/fmt/printf.h"
+#include "util/coarse_clock.h"
+
+namespace webkit {
+static const char *const StageNameArr[StageTrace::eStampNum] = {
+    "accept",         "wait_readable", "recv_queue", "recv",
+    "dispatch_queue", "dispatch",      "modify",     "wait_writable",
+    "send_queue",     "send"};
+
+struct StageHistogram {
+  StageHistogram() {
+    MetricsRegistry *registry = MetricsRegistry::GetInstance();
+    stage_arr[StageTrace::eStampAccept] = nullptr;
+    for (int i = StageTrace::eStampRecvReady; i < StageTrace::eStampNum; i++) {
+      stage_arr[i] =
+          registry->GetHistogram(fmt::sprintf("stage.%s_ns", StageNameArr[i]));
+    }
+    total = registry->GetHistogram("stage.total_ns");
+  }
+
+  Histogram *stage_arr[StageTrace::eStampNum];
+  Histogram *total;
+};
+
+uint64_t StageTrace::GetStageNs(StampType stamp) const {
+  if (tick_arr_[stamp] == 0) return 0;
+  for (int prev = stamp - 1; prev >= 0; prev--) {
+    if (tick_arr_[prev] == 0) continue;
+    if (tick_arr_[stamp] <= tick_arr_[prev]) return 0;
+    return TscClock::GetInstance()->ToNs(tick_arr_[stamp] - tick_arr_[prev]);
+  }
+  return 0;
+}
+
+uint64_t StageTrace::GetTotalNs() const {
+  uint64_t first = 0;
+  uint64_t last = 0;
+  for (uint64_t tick : tick_arr_) {
+    if (tick == 0) continue;
+    if (first == 0) first = tick;
+    last = tick;
+  }
+  if (last <= first) return 0;
+  return TscClock::GetInstance()->ToNs(last - first);
+}
+
+void StageTrace::Record() const {
+  static const StageHistogram stage_histogram;
+  for (int i = eStampRecvReady; i < eStampNum; i++) {
+    if (tick_arr_[i] == 0) continue;
+    stage_histogram.stage_arr[i]->Record(
+        GetStageNs(static_cast<StampType>(i)));
+  }
+  stage_histogram.total->Record(GetTotalNs());
+}
+
+const char *StageTrace::GetStageName(StampType stamp) {
+  return StageNameArr[stamp];
+}
+
+SlowRequestRecorder::SlowRequestRecorder()
+    : record_vec_(kCapacity), next_(0), total_num_(0) {}
+
+void SlowRequestRecorder::Add(const StageTrace &trace, int fd) {
+  Record record;
+  record.timestamp_ms = CoarseClock::GetInstance()->NowMs();
+  record.fd = fd;
+  record.total_ns = trace.GetTotalNs();
+  for (int i = 0; i < StageTrace::eStampNum; i++) {
+    record.stage_ns[i] = trace.GetStageNs(static_cast<StageTrace::StampType>(i));
+  }
+
+  std::lock_guard<std::mutex> lg(mutex_);
+  record_vec_[next_] = record;
+  next_ = (next_ + 1) % kCapacity;
+  total_num_++;
+}
+
+std::string SlowRequestRecorder::Dump() {
+  std::lock_guard<std::mutex> lg(mutex_);
+  std::string str = fmt::sprintf("slow request total %lu\n", total_num_);
+  size_t num = std::min<uint64_t>(total_num_, kCapacity);
+  size_t idx = (next_ + kCapacity - num) % kCapacity;
+  for (size_t i = 0; i < num; i++, idx = (idx + 1) % kCapacity) {
+    const Record &record = record_vec_[idx];
+    str += fmt::sprintf("%lu fd %d total_ns %lu", record.timestamp_ms,
+                        record.fd, record.total_ns);
+    for (int j = StageTrace::eStampRecvReady; j < StageTrace::eStampNum; j++) {
+      str += fmt::sprintf(" %s %lu", StageNameArr[j], record.stage_ns[j]);
+    }
+    str += "\n";
+  }
+  return str;
+}
+}  // namespace webkit
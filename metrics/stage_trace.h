@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "util/tsc_clock.h"
+
+namespace webkit {
+// tick stamps taken along one request, from accept to the end of the reply,
+// each stage is the time between a stamp and the previous one
+class StageTrace {
+ public:
+  enum StampType {
+    eStampAccept = 0,
+    // the reactor wait that reported the request returned, recv_queue is
+    // the time the io thread spent on the events before it
+    eStampRecvReady,
+    eStampRecvStart,
+    eStampRecvEnd,
+    eStampDispatchStart,
+    eStampDispatchEnd,
+    // the io thread is about to arm the event for the reply, modify is the
+    // time the rearm waited to be run there
+    eStampModifyStart,
+    eStampSendReady,
+    eStampSendStart,
+    eStampSendEnd,
+    eStampNum,
+  };
+
+  StageTrace() { Reset(); }
+
+  ~StageTrace() = default;
+
+  void Reset() {
+    for (uint64_t &tick : tick_arr_) tick = 0;
+  }
+
+  void Stamp(StampType stamp) {
+    tick_arr_[stamp] = TscClock::GetInstance()->Now();
+  }
+
+  void Stamp(StampType stamp, uint64_t tick) { tick_arr_[stamp] = tick; }
+
+  bool HasStamp(StampType stamp) const { return tick_arr_[stamp] != 0; }
+
+  // ns between stamp and the previous taken stamp, 0 if stamp is missing
+  uint64_t GetStageNs(StampType stamp) const;
+
+  uint64_t GetTotalNs() const;
+
+  // record every stage into the "stage.<name>_ns" histograms
+  void Record() const;
+
+  static const char *GetStageName(StampType stamp);
+
+ private:
+  uint64_t tick_arr_[eStampNum];
+};
+
+// bounded ring of the latest requests slower than the server threshold
+class SlowRequestRecorder {
+ private:
+  SlowRequestRecorder();
+
+ public:
+  static constexpr size_t kCapacity = 256;
+
+  struct Record {
+    uint64_t timestamp_ms;
+    int fd;
+    uint64_t total_ns;
+    uint64_t stage_ns[StageTrace::eStampNum];
+  };
+
+  ~SlowRequestRecorder() = default;
+
+  static SlowRequestRecorder *GetInstance() {
+    static SlowRequestRecorder instance;
+    return &instance;
+  }
+
+  void Add(const StageTrace &trace, int fd);
+
+  // one line per record, oldest first
+  std::string Dump();
+
+ private:
+  std::mutex mutex_;
+  std::vector<Record> record_vec_;
+  size_t next_;
+  uint64_t total_num_;
+};
+}  // namespace webkit
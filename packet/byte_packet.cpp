@@ -1,17 +1,29 @@
 #include "byte_packet.h"
 
+#include <unistd.h>
+
 #include <algorithm>
 
+#include "metrics/metrics.h"
 #include "webkit/logger.h"
 
 namespace webkit {
+static Gauge *GetPacketBytesGauge() {
+  static Gauge *packet_bytes =
+      MetricsRegistry::GetInstance()->GetGauge("packet.bytes");
+  return packet_bytes;
+}
+
 BytePacketBuf::BytePacketBuf(size_t capacity)
     : buffer_(nullptr), size_(0), capacity_(capacity) {
   setg(nullptr, nullptr, nullptr);
   setp(nullptr, nullptr);
 }
 
-BytePacketBuf::~BytePacketBuf() { delete[] buffer_; }
+BytePacketBuf::~BytePacketBuf() {
+  GetPacketBytesGauge()->Sub(size_);
+  delete[] buffer_;
+}
 
 Status BytePacketBuf::Write(const void *src, size_t src_size,
                             size_t &write_size) {
@@ -115,6 +127,41 @@ Status BytePacketBuf::Read(IoBase &dst, size_t dst_size, size_t &read_size) {
   return Status::OK();
 }
 
+Status BytePacketBuf::Peek(void *dst, size_t dst_size, size_t &read_size) {
+  Fit();
+  size_t data_size = std::min(GetDataSize(), dst_size);
+  size_t tail_size =
+      std::min(data_size, static_cast<size_t>(egptr() - gptr()));
+  memcpy(dst, gptr(), tail_size);
+  // the rest wrapped around to the buffer head
+  memcpy(reinterpret_cast<std::byte *>(dst) + tail_size, buffer_,
+         data_size - tail_size);
+  read_size = data_size;
+  return Status::OK();
+}
+
+// same walk as Read, the tail up to egptr first, then the rest from the
+// buffer head
+void BytePacketBuf::GetSpan(const void *&data, size_t &size) {
+  Fit();
+  size_t data_size = GetDataSize();
+  size_t tail_size = static_cast<size_t>(egptr() - gptr());
+  data = gptr();
+  size = tail_size > 0 ? std::min(data_size, tail_size) : data_size;
+}
+
+void BytePacketBuf::Consume(size_t size) {
+  Fit();
+  size_t data_size = std::min(GetDataSize(), size);
+  if (gptr() + data_size >= egptr()) {
+    size_t tail_size = static_cast<size_t>(egptr() - gptr());
+    gbump(tail_size);
+    Fit();
+    data_size -= tail_size;
+  }
+  gbump(data_size);
+}
+
 BytePacketBuf::int_type BytePacketBuf::overflow(int_type c) {
   if (pptr() < gptr()) {
     setp(pptr(), gptr());
@@ -149,7 +196,7 @@ BytePacketBuf::int_type BytePacketBuf::underflow() {
 void BytePacketBuf::Clear() {
   char *ptr = reinterpret_cast<char *>(buffer_);
   setg(ptr, ptr, ptr);
-  setp(ptr, ptr);
+  setp(ptr, ptr + size_);
 }
 
 size_t BytePacketBuf::GetDataSize() const {
@@ -170,6 +217,7 @@ Status BytePacketBuf::Expand(size_t alloc_size) {
   size_t data_size;
   Fold(new_buffer, data_size);
   std::swap(buffer_, new_buffer);
+  GetPacketBytesGauge()->Add(new_size - size_);
   size_ = new_size;
   setp(reinterpret_cast<char *>(buffer_) + data_size,
        reinterpret_cast<char *>(buffer_) + size_);
@@ -215,27 +263,148 @@ void BytePacketBuf::Fold(std::byte *dst, size_t &dst_size) {
   gbump(data_size);
 }
 
-BytePacket::BytePacket(size_t capacity) : buf_(capacity), Packet(&buf_) {}
+BytePacket::BytePacket(size_t capacity)
+    : buf_(capacity), Packet(&buf_), file_size_(0) {}
+
+BytePacket::~BytePacket() {
+  for (const Span &span : file_span_vec_) close(span.fd);
+}
 
 Status BytePacket::Write(const void *src, size_t src_size, size_t &write_size) {
+  if (!file_span_vec_.empty()) {
+    WEBKIT_LOGERROR("packet write after file");
+    return Status::Error(StatusCode::ePacketFileError, "write after file");
+  }
   return buf_.Write(src, src_size, write_size);
 }
 
 Status BytePacket::Write(IoBase &src, size_t src_size, size_t &write_size) {
+  if (!file_span_vec_.empty()) {
+    WEBKIT_LOGERROR("packet write after file");
+    return Status::Error(StatusCode::ePacketFileError, "write after file");
+  }
   return buf_.Write(src, src_size, write_size);
 }
 
 Status BytePacket::Read(void *dst, size_t dst_size, size_t &read_size) {
-  return buf_.Read(dst, dst_size, read_size);
+  Status s = buf_.Read(dst, dst_size, read_size);
+  if (!s.Ok() || read_size == dst_size || file_size_ == 0) return s;
+  size_t file_read_size = 0;
+  s = ReadFile(reinterpret_cast<std::byte *>(dst) + read_size,
+               dst_size - read_size, file_read_size, true);
+  read_size += file_read_size;
+  return s;
 }
 
 Status BytePacket::Read(IoBase &dst, size_t dst_size, size_t &read_size) {
-  return buf_.Read(dst, dst_size, read_size);
+  Status s = buf_.Read(dst, dst_size, read_size);
+  if (!s.Ok() || read_size == dst_size || file_size_ == 0) return s;
+  std::vector<std::byte> chunk(std::min(dst_size - read_size, 64UL << 10));
+  while (read_size < dst_size && file_size_ > 0) {
+    size_t chunk_size = 0;
+    s = ReadFile(chunk.data(), std::min(dst_size - read_size, chunk.size()),
+                 chunk_size, false);
+    if (!s.Ok()) return s;
+    size_t write_size = 0;
+    s = dst.Write(chunk.data(), chunk_size, write_size);
+    Consume(write_size);
+    read_size += write_size;
+    if (!s.Ok() || write_size != chunk_size) {
+      WEBKIT_LOGERROR("write dst expect %zu get %zu status code %d message %s",
+                      chunk_size, write_size, s.Code(), s.Message());
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+Status BytePacket::Peek(void *dst, size_t dst_size, size_t &read_size) {
+  Status s = buf_.Peek(dst, dst_size, read_size);
+  if (!s.Ok() || read_size == dst_size || file_size_ == 0) return s;
+  size_t file_read_size = 0;
+  s = ReadFile(reinterpret_cast<std::byte *>(dst) + read_size,
+               dst_size - read_size, file_read_size, false);
+  read_size += file_read_size;
+  return s;
 }
 
-void BytePacket::Clear() { buf_.Clear(); }
+Status BytePacket::AppendFile(int fd, off_t offset, size_t size) {
+  if (fd < 0) {
+    WEBKIT_LOGERROR("packet append file invalid fd %d", fd);
+    return Status::Error(StatusCode::eParamError, "invalid fd");
+  }
+  if (size == 0) {
+    close(fd);
+    return Status::OK();
+  }
+  file_span_vec_.push_back(Span{nullptr, fd, offset, size});
+  file_size_ += size;
+  return Status::OK();
+}
+
+Packet::Span BytePacket::GetSpan() {
+  Span span{nullptr, -1, 0, 0};
+  buf_.GetSpan(span.data, span.size);
+  if (span.size == 0 && !file_span_vec_.empty()) span = file_span_vec_[0];
+  return span;
+}
 
-size_t BytePacket::GetDataSize() const { return buf_.GetDataSize(); }
+void BytePacket::Consume(size_t size) {
+  size_t buf_size = std::min(size, buf_.GetDataSize());
+  buf_.Consume(buf_size);
+  size -= buf_size;
+  size_t span_idx = 0;
+  while (size > 0 && span_idx < file_span_vec_.size()) {
+    Span &span = file_span_vec_[span_idx];
+    size_t span_size = std::min(size, span.size);
+    span.offset += span_size;
+    span.size -= span_size;
+    file_size_ -= span_size;
+    size -= span_size;
+    if (span.size == 0) {
+      close(span.fd);
+      span_idx++;
+    }
+  }
+  file_span_vec_.erase(file_span_vec_.begin(),
+                       file_span_vec_.begin() + span_idx);
+}
+
+void BytePacket::Clear() {
+  buf_.Clear();
+  for (const Span &span : file_span_vec_) close(span.fd);
+  file_span_vec_.clear();
+  file_size_ = 0;
+}
+
+size_t BytePacket::GetDataSize() const {
+  return buf_.GetDataSize() + file_size_;
+}
+
+Status BytePacket::ReadFile(void *dst, size_t size, size_t &read_size,
+                            bool is_consume) {
+  read_size = 0;
+  for (const Span &span : file_span_vec_) {
+    size_t span_read_size = 0;
+    while (read_size < size && span_read_size < span.size) {
+      ssize_t nread =
+          pread(span.fd, reinterpret_cast<std::byte *>(dst) + read_size,
+                std::min(size - read_size, span.size - span_read_size),
+                span.offset + span_read_size);
+      if (nread < 0 && errno == EINTR) continue;
+      if (nread <= 0) {
+        WEBKIT_LOGERROR("packet read file fd %d error %d %s", span.fd, errno,
+                        strerror(errno));
+        return Status::Error(StatusCode::ePacketFileError, "read file error");
+      }
+      span_read_size += nread;
+      read_size += nread;
+    }
+    if (read_size == size) break;
+  }
+  if (is_consume) Consume(read_size);
+  return Status::OK();
+}
 
 BytePacketFactory::BytePacketFactory(ServerConfig *p_config)
     : p_config_(p_config) {}
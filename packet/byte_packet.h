@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <vector>
 
 #include "webkit/packet.h"
 #include "webkit/server_config.h"
@@ -22,6 +23,13 @@ class BytePacketBuf : public IoBase, public std::streambuf {
 
   virtual Status Read(IoBase &dst, size_t dst_size, size_t &read_size) override;
 
+  Status Peek(void *dst, size_t dst_size, size_t &read_size);
+
+  // contiguous data at the head, size 0 if empty
+  void GetSpan(const void *&data, size_t &size);
+
+  void Consume(size_t size);
+
   virtual int_type overflow(int_type c) override;
 
   virtual int_type underflow() override;
@@ -48,7 +56,7 @@ class BytePacket : public Packet {
  public:
   BytePacket(size_t capacity);
 
-  virtual ~BytePacket() = default;
+  virtual ~BytePacket();
 
   virtual Status Write(const void *src, size_t src_size,
                        size_t &write_size) override;
@@ -60,12 +68,25 @@ class BytePacket : public Packet {
 
   virtual Status Read(IoBase &dst, size_t dst_size, size_t &read_size) override;
 
+  virtual Status Peek(void *dst, size_t dst_size, size_t &read_size) override;
+
+  virtual Status AppendFile(int fd, off_t offset, size_t size) override;
+
+  virtual Span GetSpan() override;
+
+  virtual void Consume(size_t size) override;
+
   virtual void Clear();
 
   virtual size_t GetDataSize() const;
 
  private:
+  // copy up to size bytes of the appended files, they follow the buffer
+  Status ReadFile(void *dst, size_t size, size_t &read_size, bool is_consume);
+
   BytePacketBuf buf_;
+  std::vector<Span> file_span_vec_;
+  size_t file_size_;
 };
 
 class BytePacketFactory : public PacketFactory {
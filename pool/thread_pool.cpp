@@ -1,59 +1,262 @@
 #include "thread_pool.h"
 
+#include <algorithm>
+
+#include "util/cpu_affinity.h"
+#include "webkit/logger.h"
+
 namespace webkit {
 ThreadPool::ThreadPool(uint32_t thread_num, size_t capacity)
-    : thread_num_(thread_num), queue_(capacity), is_running_(false) {}
+    : ThreadPool(thread_num, {PoolLane{1, capacity}}, eStrictPriority) {}
+
+ThreadPool::ThreadPool(uint32_t thread_num,
+                       const std::vector<PoolLane> &lane_vec,
+                       ScheduleType schedule_type)
+    : thread_num_(thread_num),
+      schedule_type_(schedule_type),
+      task_num_(0),
+      wake_seq_(0),
+      is_running_(false),
+      busy_num_(0),
+      queue_depth_(
+          MetricsRegistry::GetInstance()->GetHistogram("pool.queue_depth")) {
+  for (const PoolLane &lane : lane_vec) {
+    queue_vec_.push_back(
+        std::make_unique<CircularQueue<FuncType>>(lane.capacity));
+    weight_vec_.push_back(std::max(lane.weight, 1U));
+  }
+  for (uint32_t i = 0; i < thread_num_; i++) {
+    auto worker_up = std::make_unique<Worker>();
+    worker_up->queue =
+        std::make_unique<CircularQueue<FuncType>>(lane_vec[0].capacity);
+    worker_up->task_num = 0;
+    worker_up->is_waiting = false;
+    worker_vec_.push_back(std::move(worker_up));
+  }
+}
 
 ThreadPool::~ThreadPool() { Stop(); }
 
+void ThreadPool::SetCpuVec(const std::vector<uint32_t> &cpu_vec) {
+  cpu_vec_ = cpu_vec;
+}
+
 void ThreadPool::Run() {
   is_running_ = true;
   for (uint32_t idx = 0; idx < thread_num_; idx++) {
-    thread_vec_.emplace_back([&] {
-      while (is_running_) {
-        if (queue_.IsEmpty()) {
-          std::unique_lock<std::mutex> ul(run_mutex_);
-          run_cv_.wait(ul, [&] { return !queue_.IsEmpty() || !is_running_; });
-          ul.unlock();
-        }
-        if (!is_running_) break;
-        FuncType func;
-        Status s = queue_.Pop(func);
-        if (!s.Ok()) continue;
-        submit_cv_.notify_one();
-        func();
-      }
-    });
+    thread_vec_.emplace_back([this, idx] { RunWorker(idx); });
   }
 }
 
 void ThreadPool::Stop() {
   is_running_ = false;
   submit_cv_.notify_all();
-  run_cv_.notify_all();
+  for (std::unique_ptr<Worker> &worker_up : worker_vec_) {
+    { std::lock_guard<std::mutex> lg(worker_up->mutex); }
+    worker_up->cv.notify_all();
+  }
   for (std::thread &t : thread_vec_) t.join();
   thread_vec_.clear();
 }
 
+void ThreadPool::RunWorker(uint32_t worker_idx) {
+  if (!cpu_vec_.empty()) {
+    uint32_t cpu = cpu_vec_[worker_idx % cpu_vec_.size()];
+    Status s = CpuAffinity::PinThread({cpu});
+    if (!s.Ok()) {
+      WEBKIT_LOGERROR("worker %u pin to cpu %u error status code %d message %s",
+                      worker_idx, cpu, s.Code(), s.Message());
+    }
+  }
+  Worker &worker = *worker_vec_[worker_idx];
+  std::vector<uint32_t> credit_vec = weight_vec_;
+  while (is_running_) {
+    FuncType func;
+    if (!PopTask(worker, credit_vec, func)) {
+      Wait(worker);
+      continue;
+    }
+    submit_cv_.notify_one();
+    busy_num_.fetch_add(1, std::memory_order_relaxed);
+    func();
+    busy_num_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+// the worker publishes is_waiting before it checks the task counters and a
+// submitter bumps a counter before it checks is_waiting, all sequentially
+// consistent, so either the worker sees the task or the submitter wakes it
+void ThreadPool::Wait(Worker &worker) {
+  std::unique_lock<std::mutex> ul(worker.mutex);
+  worker.is_waiting.store(true);
+  while (is_running_ && task_num_.load() == 0 && worker.task_num.load() == 0) {
+    worker.cv.wait(ul);
+    // a waker clears the flag, set it again before checking once more
+    worker.is_waiting.store(true);
+  }
+  worker.is_waiting.store(false);
+}
+
+void ThreadPool::WakeIdle(size_t num) {
+  uint32_t begin = wake_seq_.fetch_add(1, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < thread_num_ && num > 0; i++) {
+    if (Wake(*worker_vec_[(begin + i) % thread_num_])) num--;
+  }
+}
+
+bool ThreadPool::Wake(Worker &worker) {
+  if (!worker.is_waiting.exchange(false)) return false;
+  // the worker holds its mutex from the checks until it sleeps
+  { std::lock_guard<std::mutex> lg(worker.mutex); }
+  worker.cv.notify_one();
+  return true;
+}
+
 Status ThreadPool::Submit(FuncType func) {
-  if (queue_.IsFull()) {
+  CircularQueue<FuncType> &queue = *queue_vec_[0];
+  if (queue.IsFull()) {
     std::unique_lock<std::mutex> ul(submit_mutex_);
-    submit_cv_.wait(ul, [&] { return !queue_.IsFull() || !is_running_; });
+    submit_cv_.wait(ul, [&] { return !queue.IsFull() || !is_running_; });
     ul.unlock();
   }
   if (!is_running_) {
     return Status::Error(StatusCode::ePoolStopped, "thread pool stopped");
   }
-  Status s = queue_.Push(func);
+  queue_depth_->Record(task_num_.load(std::memory_order_relaxed));
+  Status s = queue.Push(std::move(func));
+  if (!s.Ok()) return s;
+  task_num_.fetch_add(1);
+  WakeIdle(1);
+  return Status::OK();
+}
+
+Status ThreadPool::Submit(uint64_t key, FuncType func) {
+  if (!is_running_) {
+    return Status::Error(StatusCode::ePoolStopped, "thread pool stopped");
+  }
+  // keys such as pointers or fds are rarely uniform in their low bits
+  uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+  Worker &worker = *worker_vec_[(hash >> 32) % thread_num_];
+  queue_depth_->Record(worker.task_num.load(std::memory_order_relaxed));
+  Status s = worker.queue->Push(std::move(func));
+  if (s.Code() == StatusCode::eCircularQueueFull) {
+    return Status::Warn(StatusCode::ePoolFull, "thread pool worker full");
+  }
+  if (!s.Ok()) return s;
+  worker.task_num.fetch_add(1);
+  Wake(worker);
+  return Status::OK();
+}
+
+Status ThreadPool::TrySubmit(FuncType func) {
+  return TrySubmit(0, std::move(func));
+}
+
+Status ThreadPool::TrySubmit(uint32_t lane, FuncType func) {
+  if (!is_running_) {
+    return Status::Error(StatusCode::ePoolStopped, "thread pool stopped");
+  }
+  if (lane >= queue_vec_.size()) lane = queue_vec_.size() - 1;
+  queue_depth_->Record(task_num_.load(std::memory_order_relaxed));
+  Status s = queue_vec_[lane]->Push(std::move(func));
+  if (s.Code() == StatusCode::eCircularQueueFull) {
+    return Status::Warn(StatusCode::ePoolFull, "thread pool full");
+  }
   if (!s.Ok()) return s;
-  run_cv_.notify_one();
+  task_num_.fetch_add(1);
+  WakeIdle(1);
   return Status::OK();
 }
 
+Status ThreadPool::SubmitN(uint32_t lane, FuncType *func_arr, size_t func_num,
+                           size_t &submit_num) {
+  submit_num = 0;
+  if (!is_running_) {
+    return Status::Error(StatusCode::ePoolStopped, "thread pool stopped");
+  }
+  if (lane >= queue_vec_.size()) lane = queue_vec_.size() - 1;
+  queue_depth_->Record(task_num_.load(std::memory_order_relaxed));
+  CircularQueue<FuncType> &queue = *queue_vec_[lane];
+  while (submit_num < func_num &&
+         queue.Push(std::move(func_arr[submit_num])).Ok()) {
+    submit_num++;
+  }
+  if (submit_num > 0) {
+    task_num_.fetch_add(submit_num);
+    WakeIdle(submit_num);
+  }
+  if (submit_num < func_num) {
+    return Status::Warn(StatusCode::ePoolFull, "thread pool full");
+  }
+  return Status::OK();
+}
+
+bool ThreadPool::PopTask(Worker &worker, std::vector<uint32_t> &credit_vec,
+                         FuncType &func) {
+  if (worker.task_num.load(std::memory_order_relaxed) != 0 &&
+      worker.queue->Pop(func).Ok()) {
+    worker.task_num.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t lane_num = queue_vec_.size();
+  if (schedule_type_ == eStrictPriority || lane_num == 1) {
+    for (size_t i = 0; i < lane_num; i++) {
+      if (!queue_vec_[i]->Pop(func).Ok()) continue;
+      task_num_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  // deficit round robin, a lane found empty gives up the rest of its turn so
+  // an idle lane does not bank credit, all credits are refilled once spent
+  for (int round = 0; round < 2; round++) {
+    for (size_t i = 0; i < lane_num; i++) {
+      if (credit_vec[i] == 0) continue;
+      if (queue_vec_[i]->Pop(func).Ok()) {
+        credit_vec[i]--;
+        task_num_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+      credit_vec[i] = 0;
+    }
+    credit_vec = weight_vec_;
+  }
+  return false;
+}
+
+uint32_t ThreadPool::GetLaneNum() const { return queue_vec_.size(); }
+
+size_t ThreadPool::GetTaskNum() const {
+  size_t task_num = task_num_.load(std::memory_order_relaxed);
+  for (const std::unique_ptr<Worker> &worker_up : worker_vec_) {
+    task_num += worker_up->task_num.load(std::memory_order_relaxed);
+  }
+  return task_num;
+}
+
+size_t ThreadPool::GetLaneTaskNum(uint32_t lane) const {
+  if (lane >= queue_vec_.size()) return 0;
+  return queue_vec_[lane]->Size();
+}
+
+uint32_t ThreadPool::GetBusyNum() const {
+  return busy_num_.load(std::memory_order_relaxed);
+}
+
 ThreadPoolFactory::ThreadPoolFactory(uint32_t thread_num, size_t capacity)
-    : thread_num_(thread_num), capacity_(capacity) {}
+    : ThreadPoolFactory(thread_num, {PoolLane{1, capacity}},
+                        ThreadPool::eStrictPriority) {}
+
+ThreadPoolFactory::ThreadPoolFactory(uint32_t thread_num,
+                                     const std::vector<PoolLane> &lane_vec,
+                                     ThreadPool::ScheduleType schedule_type)
+    : thread_num_(thread_num),
+      lane_vec_(lane_vec),
+      schedule_type_(schedule_type) {}
 
 std::shared_ptr<Pool> ThreadPoolFactory::Build() {
-  return std::make_shared<ThreadPool>(thread_num_, capacity_);
+  return std::make_shared<ThreadPool>(thread_num_, lane_vec_, schedule_type_);
 }
-}  // namespace webkit
\ No newline at end of file
+}  // namespace webkit
@@ -1,50 +1,127 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <thread>
 #include <vector>
 
+#include "metrics/metrics.h"
 #include "util/circular_queue.h"
 #include "webkit/packet.h"
 #include "webkit/pool.h"
 
 namespace webkit {
+struct PoolLane {
+  // share of the workers under eWeightedFair, ignored by eStrictPriority
+  uint32_t weight;
+  // queued tasks above it are refused with ePoolFull
+  size_t capacity;
+};
+
 class ThreadPool : public Pool {
  public:
+  enum ScheduleType {
+    // always run the lowest numbered non empty lane first
+    eStrictPriority = 0,
+    // every worker serves the lanes round robin, weight tasks per turn
+    eWeightedFair = 1,
+  };
+
+  // a single lane
   ThreadPool(uint32_t thread_num, size_t capacity);
 
+  ThreadPool(uint32_t thread_num, const std::vector<PoolLane> &lane_vec,
+             ScheduleType schedule_type);
+
   ~ThreadPool();
 
+  void SetCpuVec(const std::vector<uint32_t> &cpu_vec) override;
+
   void Run() override;
 
   void Stop() override;
 
   Status Submit(FuncType func) override;
 
+  Status Submit(uint64_t key, FuncType func) override;
+
+  Status TrySubmit(FuncType func) override;
+
+  Status TrySubmit(uint32_t lane, FuncType func) override;
+
+  Status SubmitN(uint32_t lane, FuncType *func_arr, size_t func_num,
+                 size_t &submit_num) override;
+
+  uint32_t GetLaneNum() const override;
+
+  size_t GetTaskNum() const override;
+
+  size_t GetLaneTaskNum(uint32_t lane) const override;
+
+  uint32_t GetBusyNum() const override;
+
  private:
+  // a worker sleeps on its own condition variable, so a keyed task wakes
+  // exactly the worker that owns it
+  struct Worker {
+    // keyed tasks, served before the shared lanes
+    std::unique_ptr<CircularQueue<FuncType>> queue;
+    std::atomic<size_t> task_num;
+    std::atomic<bool> is_waiting;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+
+  void RunWorker(uint32_t worker_idx);
+
+  // sleep until a shared or a keyed task is queued or the pool stops
+  void Wait(Worker &worker);
+
+  // wake up to num sleeping workers for shared tasks
+  void WakeIdle(size_t num);
+
+  // wake worker if it sleeps, false if it was awake
+  bool Wake(Worker &worker);
+
+  // credit_vec holds the calling worker's remaining turns per lane
+  bool PopTask(Worker &worker, std::vector<uint32_t> &credit_vec,
+               FuncType &func);
+
   uint32_t thread_num_;
+  std::vector<uint32_t> cpu_vec_;
   std::vector<std::thread> thread_vec_;
-  CircularQueue<FuncType> queue_;
-
-  std::mutex run_mutex_;
-  std::condition_variable run_cv_;
+  std::vector<std::unique_ptr<Worker>> worker_vec_;
+  std::vector<std::unique_ptr<CircularQueue<FuncType>>> queue_vec_;
+  std::vector<uint32_t> weight_vec_;
+  ScheduleType schedule_type_;
+  // shared lane tasks only, keyed ones are counted per worker
+  std::atomic<size_t> task_num_;
+  std::atomic<uint32_t> wake_seq_;
 
   std::mutex submit_mutex_;
   std::condition_variable submit_cv_;
 
-  bool is_running_;
+  std::atomic<bool> is_running_;
+  std::atomic<uint32_t> busy_num_;
+
+  Histogram *queue_depth_;
 };
 
 class ThreadPoolFactory : public PoolFactory {
  public:
   ThreadPoolFactory(uint32_t thread_num, size_t capacity);
 
+  ThreadPoolFactory(uint32_t thread_num, const std::vector<PoolLane> &lane_vec,
+                    ThreadPool::ScheduleType schedule_type);
+
   ~ThreadPoolFactory() = default;
 
   std::shared_ptr<Pool> Build() override;
 
  private:
   uint32_t thread_num_;
-  size_t capacity_;
+  std::vector<PoolLane> lane_vec_;
+  ThreadPool::ScheduleType schedule_type_;
 };
-}  // namespace webkit
\ No newline at end of file
+}  // namespace webkit
@@ -12,7 +12,8 @@ EpollEvent::EpollEvent(std::shared_ptr<Epoller> epoller_sp,
       socket_sp_(socket_sp),
       packet_sp_(packet_sp),
       is_et_mode_(is_et_mode),
-      is_busy_(false) {
+      is_busy_(false),
+      trace_context_{} {
   memset(&epoll_event_, 0, sizeof(epoll_event_));
   epoll_event_.data.ptr = this;
 }
@@ -29,7 +30,18 @@ void EpollEvent::SetReadyToSend() {
 }
 
 bool EpollEvent::IsReadyToSend() const {
-  return epoll_event_.events & EPOLLOUT;
+  return epoll_event_.events & (EPOLLOUT | EPOLLRDNORM);
+}
+
+void EpollEvent::SetReadyToResume() {
+  // a readable socket also reports EPOLLRDNORM, waiting on it instead of
+  // EPOLLIN keeps this state apart from the recv state
+  if (socket_sp_->IsWriteWaitReadable()) {
+    epoll_event_.events |= EPOLLRDNORM | EPOLLRDHUP;
+  } else {
+    epoll_event_.events |= EPOLLOUT | EPOLLRDHUP;
+  }
+  if (is_et_mode_) epoll_event_.events |= EPOLLET;
 }
 
 void EpollEvent::SetReadyToRecv() {
@@ -39,11 +51,28 @@ void EpollEvent::SetReadyToRecv() {
 
 bool EpollEvent::IsReadyToRecv() const { return epoll_event_.events & EPOLLIN; }
 
+void EpollEvent::SetReadyToReap() {
+  // epoll always reports EPOLLERR, it is set to tell this state apart
+  epoll_event_.events |= EPOLLERR;
+  if (is_et_mode_) epoll_event_.events |= EPOLLET;
+}
+
+bool EpollEvent::IsReadyToReap() const {
+  return epoll_event_.events & EPOLLERR;
+}
+
 Status EpollEvent::Send() {
-  std::shared_ptr<ProtocolAdapter> adapter_sp =
-      ProtocolAdapterFactory::GetDefaultInstance()->Build(
-          *packet_sp_, *socket_sp_, packet_sp_->GetDataSize());
-  Status s = adapter_sp->AdaptTo();
+  if (send_adapter_sp_ == nullptr) {
+    send_adapter_sp_ = ProtocolAdapterFactory::GetDefaultInstance()->Build(
+        *packet_sp_, *socket_sp_, packet_sp_->GetDataSize());
+  }
+  socket_sp_->Cork(true);
+  Status s = send_adapter_sp_->AdaptTo();
+  socket_sp_->Cork(false);
+  if (s.Code() == StatusCode::eRetry) {
+    return Status::Debug(StatusCode::eRetry, "event send partial frame");
+  }
+  send_adapter_sp_.reset();
   if (!s.Ok()) {
     WEBKIT_LOGERROR("adapt packet error status code %d message %s", s.Code(),
                     s.Message());
@@ -54,10 +83,15 @@ Status EpollEvent::Send() {
 }
 
 Status EpollEvent::Recv() {
-  std::shared_ptr<ProtocolAdapter> adapter_sp =
-      ProtocolAdapterFactory::GetDefaultInstance()->Build(*packet_sp_,
-                                                          *socket_sp_, 0);
-  Status s = adapter_sp->AdaptFrom();
+  if (recv_adapter_sp_ == nullptr) {
+    recv_adapter_sp_ = ProtocolAdapterFactory::GetDefaultInstance()->Build(
+        *packet_sp_, *socket_sp_, 0);
+  }
+  Status s = recv_adapter_sp_->AdaptFrom();
+  if (s.Code() == StatusCode::eNoData) {
+    return Status::Debug(StatusCode::eRetry, "event recv partial frame");
+  }
+  recv_adapter_sp_.reset();
   if (!s.Ok()) {
     WEBKIT_LOGERROR("adapt packet error status code %d message %s", s.Code(),
                     s.Message());
@@ -67,6 +101,8 @@ Status EpollEvent::Recv() {
   return Status::OK();
 }
 
+Status EpollEvent::Reap() { return socket_sp_->ReapSend(); }
+
 void EpollEvent::ClearEvent() { epoll_event_.events = 0; }
 
 Status EpollEvent::AddToReactor() { return epoller_sp_->Add(this); }
@@ -75,12 +111,26 @@ Status EpollEvent::DelFromReactor() { return epoller_sp_->Delete(this); }
 
 Status EpollEvent::ModInReactor() { return epoller_sp_->Modify(this); }
 
-void EpollEvent::SetBusy(bool is_busy) { is_busy_ = is_busy; }
+Status EpollEvent::PostToReactor(Task task) {
+  return epoller_sp_->Post(std::move(task));
+}
+
+void EpollEvent::SetBusy(bool is_busy) {
+  is_busy_.store(is_busy, std::memory_order_release);
+}
+
+bool EpollEvent::IsBusy() const {
+  return is_busy_.load(std::memory_order_acquire);
+}
+
+StageTrace *EpollEvent::GetStageTrace() { return &stage_trace_; }
 
-bool EpollEvent::IsBusy() const { return is_busy_; }
+TraceContext *EpollEvent::GetTraceContext() { return &trace_context_; }
 
 void EpollEvent::SetSocket(std::shared_ptr<Socket> socket_sp) {
   socket_sp_ = socket_sp;
+  recv_adapter_sp_.reset();
+  send_adapter_sp_.reset();
 }
 
 std::shared_ptr<Socket> EpollEvent::GetSocket() { return socket_sp_; }
@@ -2,10 +2,14 @@
 
 #include <sys/epoll.h>
 
+#include <atomic>
 #include <memory>
 
+#include "metrics/stage_trace.h"
+#include "util/trace_helper.h"
 #include "webkit/event.h"
 #include "webkit/packet.h"
+#include "webkit/protocol_adapter.h"
 #include "webkit/socket.h"
 
 namespace webkit {
@@ -28,14 +32,22 @@ class EpollEvent : public Event {
 
   virtual bool IsReadyToSend() const override;
 
+  virtual void SetReadyToResume() override;
+
   virtual void SetReadyToRecv() override;
 
   virtual bool IsReadyToRecv() const override;
 
+  virtual void SetReadyToReap() override;
+
+  virtual bool IsReadyToReap() const override;
+
   virtual void ClearEvent() override;
 
   virtual Status Send() override;
 
+  virtual Status Reap() override;
+
   virtual Status Recv() override;
 
   virtual Status AddToReactor() override;
@@ -44,10 +56,16 @@ class EpollEvent : public Event {
 
   virtual Status ModInReactor() override;
 
+  virtual Status PostToReactor(Task task) override;
+
   virtual void SetBusy(bool is_busy) override;
 
   virtual bool IsBusy() const override;
 
+  virtual StageTrace *GetStageTrace() override;
+
+  virtual TraceContext *GetTraceContext() override;
+
   void SetSocket(std::shared_ptr<Socket> socket_sp);
 
   std::shared_ptr<Socket> GetSocket();
@@ -60,8 +78,15 @@ class EpollEvent : public Event {
   std::shared_ptr<Epoller> epoller_sp_;
   std::shared_ptr<Socket> socket_sp_;
   std::shared_ptr<Packet> packet_sp_;
+  // kept across Recv calls so a frame split over several reads resumes
+  // where the previous read stopped
+  std::shared_ptr<ProtocolAdapter> recv_adapter_sp_;
+  // likewise for a frame larger than the socket buffer
+  std::shared_ptr<ProtocolAdapter> send_adapter_sp_;
   struct epoll_event epoll_event_;
   bool is_et_mode_;
-  bool is_busy_;
+  std::atomic<bool> is_busy_;
+  StageTrace stage_trace_;
+  TraceContext trace_context_;
 };
 }  // namespace webkit
\ No newline at end of file
@@ -1,16 +1,35 @@
 #include "epoller.h"
 
 #include <fcntl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include <thread>
 
+#include "metrics/metrics.h"
 #include "reactor/epoll_event.h"
 #include "socket/tcp_socket.h"
+#include "util/tsc_clock.h"
 #include "webkit/logger.h"
 
 namespace webkit {
+Epoller::Epoller() : Epoller(0) {}
+
 Epoller::Epoller(int max_event, int timeout_ms)
-    : max_event_(max_event), timeout_ms_(timeout_ms) {}
+    : epoll_fd_(-1),
+      wakeup_fd_(-1),
+      is_wakeup_pending_(false),
+      post_queue_(std::make_unique<CircularQueue<Task>>(kPostQueueSize)),
+      max_event_(max_event),
+      timeout_ms_(timeout_ms),
+      event_num_(0),
+      busy_poll_ns_(0),
+      last_active_ns_(0) {}
+
+Epoller::~Epoller() {
+  if (wakeup_fd_ >= 0) close(wakeup_fd_);
+  if (epoll_fd_ >= 0) close(epoll_fd_);
+}
 
 Status Epoller::Init(int flags) {
   epoll_fd_ = epoll_create1(flags);
@@ -18,6 +37,19 @@ Status Epoller::Init(int flags) {
     WEBKIT_LOGFATAL("epoller init error %d %s", errno, strerror(errno));
     return Status::Fatal(StatusCode::eEpollInitError, "epoller init error");
   }
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ < 0) {
+    WEBKIT_LOGFATAL("epoller eventfd error %d %s", errno, strerror(errno));
+    return Status::Fatal(StatusCode::eEpollInitError, "epoller init error");
+  }
+  struct epoll_event wakeup_event;
+  memset(&wakeup_event, 0, sizeof(wakeup_event));
+  wakeup_event.events = EPOLLIN;
+  wakeup_event.data.ptr = nullptr;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &wakeup_event) != 0) {
+    WEBKIT_LOGFATAL("epoller add eventfd error %d %s", errno, strerror(errno));
+    return Status::Fatal(StatusCode::eEpollInitError, "epoller init error");
+  }
   return Status::OK();
 }
 
@@ -35,6 +67,7 @@ Status Epoller::Add(EpollEvent *event) {
     WEBKIT_LOGERROR("epoller add event error %d %s", errno, strerror(errno));
     return Status::Error(StatusCode::eEpollAddError, "epoller add error");
   }
+  event_num_.fetch_add(1, std::memory_order_relaxed);
   return Status::OK();
 }
 
@@ -45,6 +78,7 @@ Status Epoller::Delete(EpollEvent *event) {
     WEBKIT_LOGERROR("epoller delete event error %d %s", errno, strerror(errno));
     return Status::Error(StatusCode::eEpollDeleteError, "epoller delete error");
   }
+  event_num_.fetch_sub(1, std::memory_order_relaxed);
   return Status::OK();
 }
 
@@ -63,22 +97,96 @@ Status Epoller::Wait(std::vector<Event *> &event_vec) {
   if (event_buffer.size() < static_cast<size_t>(max_event_)) {
     event_buffer.resize(max_event_);
   }
-  int nevent = epoll_wait(epoll_fd_, &event_buffer[0], max_event_, timeout_ms_);
+  static Histogram *wait_ns =
+      MetricsRegistry::GetInstance()->GetHistogram("reactor.wait_ns");
+  static Counter *spin_num =
+      MetricsRegistry::GetInstance()->GetCounter("reactor.spin");
+  static Counter *spin_hit_num =
+      MetricsRegistry::GetInstance()->GetCounter("reactor.spin_hit");
+  static Counter *park_num =
+      MetricsRegistry::GetInstance()->GetCounter("reactor.park");
+
+  // spin while the last activity is within the budget, spinning waits are
+  // only counted, wait_ns keeps the blocking ones
+  int nevent = 0;
+  uint64_t now_ns = busy_poll_ns_ > 0 ? TscClock::MonotonicNs() : 0;
+  if (busy_poll_ns_ > 0 && now_ns - last_active_ns_ < busy_poll_ns_) {
+    spin_num->Add();
+    nevent = epoll_wait(epoll_fd_, &event_buffer[0], max_event_, 0);
+    if (nevent > 0) spin_hit_num->Add();
+  } else {
+    park_num->Add();
+    TscClock *tsc_clock = TscClock::GetInstance();
+    uint64_t begin_tick = tsc_clock->Now();
+    nevent = epoll_wait(epoll_fd_, &event_buffer[0], max_event_, timeout_ms_);
+    wait_ns->Record(tsc_clock->ToNs(tsc_clock->Now() - begin_tick));
+  }
   if (nevent < 0) {
     WEBKIT_LOGERROR("epoller wait event error %d %s", errno, strerror(errno));
     return Status::Error(StatusCode::eEpollWaitError, "epoller wait error");
   }
   if (nevent == 0) return Status::Warn(StatusCode::eRetry);
+  if (busy_poll_ns_ > 0) last_active_ns_ = TscClock::MonotonicNs();
+  static Histogram *wait_batch =
+      MetricsRegistry::GetInstance()->GetHistogram("reactor.wait_batch");
+  wait_batch->Record(nevent);
+  bool is_woken = false;
   for (int i = 0; i < nevent; i++) {
+    if (event_buffer[i].data.ptr == nullptr) {
+      is_woken = true;
+      continue;
+    }
     event_vec.push_back(reinterpret_cast<Event *>(event_buffer[i].data.ptr));
   }
+  if (is_woken) RunPosted();
+  if (event_vec.empty()) return Status::Warn(StatusCode::eRetry);
   return Status::OK();
 }
 
+Status Epoller::Post(Task task) {
+  Status s = post_queue_->Push(std::move(task));
+  if (!s.Ok()) return s;
+  if (is_wakeup_pending_.exchange(true)) return Status::OK();
+  return Wakeup();
+}
+
+Status Epoller::Wakeup() {
+  uint64_t value = 1;
+  if (write(wakeup_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+    WEBKIT_LOGERROR("epoller wakeup error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eEpollWaitError, "epoller wakeup error");
+  }
+  return Status::OK();
+}
+
+void Epoller::RunPosted() {
+  static Counter *post_num =
+      MetricsRegistry::GetInstance()->GetCounter("reactor.post");
+  uint64_t value = 0;
+  while (read(wakeup_fd_, &value, sizeof(value)) > 0) {
+  }
+  // cleared before draining, a post racing with the drain either lands in
+  // it or sees the flag clear and writes the eventfd again
+  is_wakeup_pending_.store(false);
+  Task task;
+  while (post_queue_->Pop(task).Ok()) {
+    post_num->Add();
+    task();
+  }
+}
+
+size_t Epoller::GetEventNum() const {
+  return event_num_.load(std::memory_order_relaxed);
+}
+
 void Epoller::SetMaxEvent(int max_event) { max_event_ = max_event; }
 
 void Epoller::SetTimeoutMs(int timeout_ms) { timeout_ms_ = timeout_ms; }
 
+void Epoller::SetBusyPollUs(uint32_t busy_poll_us) {
+  busy_poll_ns_ = static_cast<uint64_t>(busy_poll_us) * 1000;
+}
+
 EpollerFactory::EpollerFactory(ServerConfig *config) : config_(config) {}
 
 std::shared_ptr<Reactor> EpollerFactory::Build() {
@@ -90,6 +198,7 @@ std::shared_ptr<Reactor> EpollerFactory::Build() {
                     s.Message());
     return nullptr;
   }
+  epoller_sp->SetBusyPollUs(config_->GetEpollerBusyPollUs());
   return epoller_sp;
 }
 }  // namespace webkit
\ No newline at end of file
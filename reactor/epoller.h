@@ -2,9 +2,11 @@
 
 #include <sys/epoll.h>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
+#include "util/circular_queue.h"
 #include "webkit/reactor.h"
 #include "webkit/server_config.h"
 #include "webkit/status.h"
@@ -14,10 +16,10 @@ class EpollEvent;
 
 class Epoller : public Reactor, public std::enable_shared_from_this<Epoller> {
  public:
-  Epoller() = default;
+  Epoller();
   Epoller(int max_event, int timeout_ms = 0);
 
-  ~Epoller() = default;
+  ~Epoller();
 
   std::shared_ptr<Event> CreateEvent(
       std::shared_ptr<Socket> socket_sp,
@@ -33,14 +35,38 @@ class Epoller : public Reactor, public std::enable_shared_from_this<Epoller> {
 
   Status Wait(std::vector<Event *> &event_vec) override;
 
+  Status Post(Task task) override;
+
+  Status Wakeup() override;
+
+  size_t GetEventNum() const override;
+
   void SetMaxEvent(int max_event);
 
   void SetTimeoutMs(int timeout_ms);
 
+  // keep polling without blocking for busy_poll_us after the last wait that
+  // returned events, then block for timeout_ms again, 0 always blocks
+  void SetBusyPollUs(uint32_t busy_poll_us);
+
  private:
+  static constexpr size_t kPostQueueSize = 4096;
+
+  // clear the eventfd and run the posted tasks
+  void RunPosted();
+
   int epoll_fd_;
+  // registered with a null data.ptr, told apart from events by that
+  int wakeup_fd_;
+  // set by the first post after a wakeup, later ones skip the eventfd write
+  std::atomic<bool> is_wakeup_pending_;
+  std::unique_ptr<CircularQueue<Task>> post_queue_;
   int max_event_;
   int timeout_ms_;
+  std::atomic<size_t> event_num_;
+  // only touched by the thread calling Wait
+  uint64_t busy_poll_ns_;
+  uint64_t last_active_ns_;
 };
 
 class EpollerFactory : public ReactorFactory {
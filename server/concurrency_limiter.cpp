@@ -0,0 +1,118 @@
+#include "concurrency_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "third_party/fmt/include/fmt/printf.h"
+#include "util/coarse_clock.h"
+
+namespace webkit {
+// rtt may exceed the no load rtt by this factor before the limit shrinks
+static constexpr double kRttTolerance = 1.5;
+// the no load rtt follows the minimum down at once and drifts up slowly, so
+// a method that really got slower is relearned
+static constexpr double kNoLoadRttDrift = 0.002;
+static constexpr double kLimitSmoothing = 0.2;
+
+GradientLimiter::GradientLimiter(uint32_t min_limit, uint32_t max_limit)
+    : min_limit_(std::max(min_limit, 1U)),
+      max_limit_(std::max(max_limit, min_limit_)),
+      limit_(min_limit_),
+      inflight_(0),
+      sample_sum_us_(0),
+      sample_num_(0),
+      max_inflight_(0),
+      window_begin_ms_(CoarseClock::GetInstance()->NowMs()),
+      no_load_rtt_us_(0),
+      limit_value_(min_limit_) {}
+
+bool GradientLimiter::TryAcquire() {
+  uint32_t inflight = inflight_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (inflight > limit_.load(std::memory_order_relaxed)) {
+    inflight_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+  uint32_t max_inflight = max_inflight_.load(std::memory_order_relaxed);
+  while (inflight > max_inflight &&
+         !max_inflight_.compare_exchange_weak(max_inflight, inflight,
+                                              std::memory_order_relaxed)) {
+  }
+  return true;
+}
+
+void GradientLimiter::Release(uint64_t rtt_us) {
+  inflight_.fetch_sub(1, std::memory_order_relaxed);
+  sample_sum_us_.fetch_add(rtt_us, std::memory_order_relaxed);
+  uint32_t sample_num =
+      sample_num_.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint64_t now_ms = CoarseClock::GetInstance()->NowMs();
+  if (sample_num < kWindowSampleNum &&
+      now_ms < window_begin_ms_.load(std::memory_order_relaxed) +
+                   kWindowMaxMs) {
+    return;
+  }
+  Update(now_ms);
+}
+
+void GradientLimiter::Update(uint64_t now_ms) {
+  std::unique_lock<std::mutex> ul(update_mutex_, std::try_to_lock);
+  if (!ul.owns_lock()) return;
+
+  uint32_t sample_num = sample_num_.exchange(0, std::memory_order_relaxed);
+  uint64_t sample_sum_us =
+      sample_sum_us_.exchange(0, std::memory_order_relaxed);
+  uint32_t max_inflight = max_inflight_.exchange(
+      inflight_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  window_begin_ms_.store(now_ms, std::memory_order_relaxed);
+  if (sample_num == 0) return;
+
+  double rtt_us =
+      std::max(static_cast<double>(sample_sum_us) / sample_num, 1.0);
+  if (no_load_rtt_us_ == 0 || rtt_us < no_load_rtt_us_) {
+    no_load_rtt_us_ = rtt_us;
+  } else {
+    no_load_rtt_us_ += (rtt_us - no_load_rtt_us_) * kNoLoadRttDrift;
+  }
+
+  double gradient =
+      std::clamp(kRttTolerance * no_load_rtt_us_ / rtt_us, 0.5, 1.0);
+  double new_limit = limit_value_ * gradient + std::sqrt(limit_value_);
+  // a method that did not use half of its limit has not shown it needs more
+  if (new_limit > limit_value_ && max_inflight < limit_value_ / 2) {
+    new_limit = limit_value_;
+  }
+  limit_value_ =
+      limit_value_ * (1 - kLimitSmoothing) + new_limit * kLimitSmoothing;
+  limit_value_ = std::clamp(limit_value_, static_cast<double>(min_limit_),
+                            static_cast<double>(max_limit_));
+  limit_.store(static_cast<uint32_t>(limit_value_), std::memory_order_relaxed);
+}
+
+AdmissionController::AdmissionController(uint32_t min_limit,
+                                         uint32_t max_limit)
+    : min_limit_(min_limit),
+      max_limit_(max_limit),
+      unknown_limiter_(min_limit, max_limit) {}
+
+GradientLimiter *AdmissionController::GetLimiter(uint32_t method_id) {
+  std::lock_guard<std::mutex> lg(mutex_);
+  std::unique_ptr<GradientLimiter> &limiter_up = limiter_map_[method_id];
+  if (limiter_up == nullptr) {
+    limiter_up = std::make_unique<GradientLimiter>(min_limit_, max_limit_);
+  }
+  return limiter_up.get();
+}
+
+std::string AdmissionController::ToString() {
+  std::string str;
+  std::lock_guard<std::mutex> lg(mutex_);
+  for (const auto &item : limiter_map_) {
+    str += fmt::sprintf("admission.%u limit %u inflight %u\n", item.first,
+                        item.second->GetLimit(), item.second->GetInflight());
+  }
+  str += fmt::sprintf("admission.unknown limit %u inflight %u\n",
+                      unknown_limiter_.GetLimit(),
+                      unknown_limiter_.GetInflight());
+  return str;
+}
+}  // namespace webkit
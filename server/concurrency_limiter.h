@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace webkit {
+// adaptive in-flight limit of one method, gradient style: every window the
+// limit is scaled by no_load_rtt / rtt and grows by sqrt(limit), so it
+// shrinks once queueing inflates the latency above the lowest latency seen
+// and probes upwards while the latency stays near it
+class GradientLimiter {
+ public:
+  GradientLimiter(uint32_t min_limit, uint32_t max_limit);
+
+  ~GradientLimiter() = default;
+
+  // take an in-flight slot, false if the method is at its limit
+  bool TryAcquire();
+
+  // give back a slot taken by TryAcquire, rtt_us is the time from
+  // admission to the end of dispatch
+  void Release(uint64_t rtt_us);
+
+  // give back a slot whose request never ran, no latency sample is taken
+  void Cancel() { inflight_.fetch_sub(1, std::memory_order_relaxed); }
+
+  uint32_t GetLimit() const { return limit_.load(std::memory_order_relaxed); }
+
+  uint32_t GetInflight() const {
+    return inflight_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr uint32_t kWindowSampleNum = 64;
+  static constexpr uint64_t kWindowMaxMs = 1000;
+
+  void Update(uint64_t now_ms);
+
+  uint32_t min_limit_;
+  uint32_t max_limit_;
+  std::atomic<uint32_t> limit_;
+  std::atomic<uint32_t> inflight_;
+
+  // samples of the current window
+  std::atomic<uint64_t> sample_sum_us_;
+  std::atomic<uint32_t> sample_num_;
+  std::atomic<uint32_t> max_inflight_;
+  std::atomic<uint64_t> window_begin_ms_;
+
+  // guarded by update_mutex_, only one thread closes a window
+  std::mutex update_mutex_;
+  double no_load_rtt_us_;
+  double limit_value_;
+};
+
+// per method limiters, methods are added on first use
+class AdmissionController {
+ public:
+  AdmissionController(uint32_t min_limit, uint32_t max_limit);
+
+  ~AdmissionController() = default;
+
+  // only for methods the dispatcher has, returned pointers stay valid for
+  // the lifetime of the controller, io threads cache them per method id
+  GradientLimiter *GetLimiter(uint32_t method_id);
+
+  // shared by every method id the dispatcher has no handler for
+  GradientLimiter *GetUnknownLimiter() { return &unknown_limiter_; }
+
+  // "admission.<method_id> limit <n> inflight <n>" per line, then
+  // "admission.unknown ..."
+  std::string ToString();
+
+ private:
+  uint32_t min_limit_;
+  uint32_t max_limit_;
+  std::mutex mutex_;
+  std::map<uint32_t, std::unique_ptr<GradientLimiter>> limiter_map_;
+  GradientLimiter unknown_limiter_;
+};
+}  // namespace webkit
@@ -0,0 +1,91 @@
+#include "listener_handoff.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "util/inet_util.h"
+#include "util/syscall.h"
+#include "webkit/logger.h"
+
+namespace webkit {
+ListenerHandoff::ListenerHandoff() : fd_(-1), is_handed_off_(false) {}
+
+ListenerHandoff::~ListenerHandoff() { Close(); }
+
+Status ListenerHandoff::Fetch(const std::string &path,
+                              std::vector<int> &fd_vec) {
+  struct sockaddr_un addr;
+  Status s = InetUtil::MakeUnixAddr(path, &addr);
+  if (!s.Ok()) return s;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    WEBKIT_LOGERROR("unix socket create error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketCreateError,
+                         "socket create error");
+  }
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return Status::Warn(StatusCode::eSocketConnectError,
+                        "no listener handoff served");
+  }
+  s = Syscall::RecvFdVec(fd, fd_vec);
+  close(fd);
+  return s;
+}
+
+Status ListenerHandoff::Listen(const std::string &path) {
+  struct sockaddr_un addr;
+  Status s = InetUtil::MakeUnixAddr(path, &addr);
+  if (!s.Ok()) return s;
+  fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    WEBKIT_LOGERROR("unix socket create error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketCreateError,
+                         "socket create error");
+  }
+  // the previous process keeps its socket open but unreachable by path
+  unlink(path.c_str());
+  if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    WEBKIT_LOGERROR("unix socket bind %s error %d %s", path, errno,
+                    strerror(errno));
+    Close();
+    return Status::Error(StatusCode::eSocketBindError, "socket bind error");
+  }
+  path_ = path;
+  is_handed_off_ = false;
+  if (chmod(path.c_str(), S_IRUSR | S_IWUSR) < 0 || listen(fd_, 1) < 0) {
+    WEBKIT_LOGERROR("unix socket listen %s error %d %s", path, errno,
+                    strerror(errno));
+    Close();
+    return Status::Error(StatusCode::eSocketListenError,
+                         "socket listen error");
+  }
+  return Status::OK();
+}
+
+Status ListenerHandoff::Handoff(const std::vector<int> &fd_vec) {
+  int cli_fd = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (cli_fd < 0) {
+    WEBKIT_LOGERROR("unix socket accept error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketAcceptError,
+                         "socket accept error");
+  }
+  Status s = Syscall::SendFdVec(cli_fd, fd_vec);
+  close(cli_fd);
+  if (s.Ok()) is_handed_off_ = true;
+  return s;
+}
+
+void ListenerHandoff::Close() {
+  if (fd_ < 0) return;
+  close(fd_);
+  fd_ = -1;
+  // after a handoff the path is served by the next process
+  if (!is_handed_off_) unlink(path_.c_str());
+  path_.clear();
+}
+}  // namespace webkit
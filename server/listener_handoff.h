@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "webkit/status.h"
+
+namespace webkit {
+// hands the listening sockets of a running server to the process replacing
+// it over a unix socket with SCM_RIGHTS, the new process accepts on the very
+// same sockets, so the kernel accept backlog survives the restart
+class ListenerHandoff {
+ public:
+  ListenerHandoff();
+
+  ~ListenerHandoff();
+
+  // receive the listening fds of the process serving path,
+  // eSocketConnectError when no process serves it
+  static Status Fetch(const std::string &path, std::vector<int> &fd_vec);
+
+  // serve path for the next process, a socket file left behind is replaced,
+  // only the owner may connect
+  Status Listen(const std::string &path);
+
+  // readable when the next process is waiting for the fds
+  int GetFd() const { return fd_; }
+
+  // send fd_vec to the waiting process, path then belongs to it
+  Status Handoff(const std::vector<int> &fd_vec);
+
+  void Close();
+
+ private:
+  int fd_;
+  std::string path_;
+  bool is_handed_off_;
+};
+}  // namespace webkit
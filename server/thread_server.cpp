@@ -1,16 +1,45 @@
 #include "thread_server.h"
 
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "metrics/stage_trace.h"
+#include "server/concurrency_limiter.h"
+#include "server/listener_handoff.h"
+#include "socket/shm_socket.h"
 #include "socket/tcp_socket.h"
+#include "socket/unix_socket.h"
+#include "third_party/fmt/include/fmt/printf.h"
+#include "util/coarse_clock.h"
+#include "util/cpu_affinity.h"
+#include "util/generator.h"
+#include "util/trace_helper.h"
+#include "util/tsc_clock.h"
+#include "webkit/binary_logger.h"
 #include "webkit/dispatcher.h"
 #include "webkit/logger.h"
 #include "webkit/packet.h"
 
 namespace webkit {
+// how often the accept loop looks at is_accepting_ while idle
+static constexpr int kAcceptPollMs = 100;
+
 ThreadServer::ThreadServer(const ServerConfig *config)
     : config_(config),
-      worker_pool_(nullptr),
       event_queue_(nullptr),
-      is_running_(false) {}
+      is_running_(false),
+      is_accepting_(false),
+      is_handed_off_(false),
+      inflight_num_(0),
+      connection_num_(
+          MetricsRegistry::GetInstance()->GetGauge("server.connection")),
+      connection_drop_(
+          MetricsRegistry::GetInstance()->GetCounter("server.connection_drop")),
+      overload_reject_(
+          MetricsRegistry::GetInstance()->GetCounter("server.overload_reject")) {}
 
 ThreadServer::~ThreadServer() {
   if (is_running_) Stop();
@@ -19,46 +48,154 @@ ThreadServer::~ThreadServer() {
 }
 
 Status ThreadServer::Init() {
-  worker_pool_ = PoolFactory::GetDefaultInstance()->Build();
+  int32_t worker_id = config_->GetWorkerId();
+  if (worker_id > static_cast<int32_t>(UidGenerator::kHostIdMask)) {
+    WEBKIT_LOGERROR("server worker id %d out of range", worker_id);
+    return Status::Error(StatusCode::eParamError, "worker id out of range");
+  }
+  if (worker_id >= 0) {
+    UidGenerator::GetInstance()->SetHostId(worker_id);
+  } else {
+    UidGenerator::GetInstance()->Init(config_->GetIp());
+  }
+  if (config_->IsNumaAware()) {
+    uint32_t node_num = CpuAffinity::GetNumaNodeNum();
+    node_cpu_vec_.resize(node_num);
+    for (uint32_t node = 0; node < node_num; node++) {
+      Status s = CpuAffinity::GetNumaNodeCpuVec(node, node_cpu_vec_[node]);
+      if (!s.Ok()) return s;
+    }
+  }
+  for (uint32_t node = 0; node < std::max<size_t>(node_cpu_vec_.size(), 1);
+       node++) {
+    std::shared_ptr<Pool> pool_sp;
+    RunOnNode(node, [&] {
+      pool_sp = PoolFactory::GetDefaultInstance()->Build();
+    });
+    pool_sp->SetCpuVec(node_cpu_vec_.empty() ? config_->GetWorkerCpuVec()
+                                             : node_cpu_vec_[node]);
+    worker_pool_vec_.push_back(pool_sp);
+  }
+  // packets of new connections are built here, each on the node of the
+  // reactors it is handed to, so accepting runs nothing on another node
+  uint32_t io_thread_num = config_->GetIoThreadNum();
+  for (uint32_t node = 0; node < node_cpu_vec_.size(); node++) {
+    size_t packet_num = 0;
+    for (uint32_t i = 0; i < io_thread_num; i++) {
+      if (GetNode(i) != node) continue;
+      packet_num +=
+          (config_->GetMaxConnection() + io_thread_num - 1) / io_thread_num;
+    }
+    auto packet_queue =
+        std::make_unique<CircularQueue<std::shared_ptr<Packet>>>(
+            std::max<size_t>(packet_num, 1));
+    RunOnNode(node, [&] {
+      for (size_t i = 0; i < packet_num; i++) {
+        packet_queue->Push(PacketFactory::GetDefaultInstance()->Build());
+      }
+    });
+    node_packet_queue_vec_.push_back(std::move(packet_queue));
+  }
   event_queue_ =
       new CircularQueue<std::shared_ptr<Event>>(config_->GetMaxConnection());
   event_free_queue_ =
       new CircularQueue<std::shared_ptr<Event>>(config_->GetMaxConnection());
+  if (config_->GetMaxMethodConcurrency() > 0) {
+    admission_controller_ = std::make_unique<AdmissionController>(
+        config_->GetMinMethodConcurrency(),
+        config_->GetMaxMethodConcurrency());
+  }
   return Status::OK();
 }
 
 Status ThreadServer::Run() {
   is_running_ = true;
-  worker_pool_->Run();
+  is_accepting_ = true;
+  CoarseClock::GetInstance()->Start();
+  for (std::shared_ptr<Pool> &pool_sp : worker_pool_vec_) pool_sp->Run();
 
-  std::vector<std::shared_ptr<Reactor>> reactor_sp_vec;
   uint32_t io_thread_num = config_->GetIoThreadNum();
   for (uint32_t i = 0; i < io_thread_num; i++) {
-    std::shared_ptr<Reactor> reactor_sp =
-        ReactorFactory::GetDefaultInstance()->Build();
-    reactor_sp_vec.push_back(reactor_sp);
+    std::shared_ptr<Reactor> reactor_sp;
+    RunOnNode(i, [&] {
+      reactor_sp = ReactorFactory::GetDefaultInstance()->Build();
+    });
+    reactor_sp_vec_.push_back(reactor_sp);
+    io_event_vec_.push_back(MetricsRegistry::GetInstance()->GetCounter(
+        fmt::sprintf("io.%u.event", i)));
+  }
+  if (AdminService::GetDefaultInstance() == nullptr) {
+    AdminService::SetDefaultInstance(this);
+  }
+  for (uint32_t i = 0; i < io_thread_num; i++) {
+    std::shared_ptr<Reactor> reactor_sp = reactor_sp_vec_[i];
     io_thread_vec_.emplace_back([=] { RunIo(i, reactor_sp); });
   }
-  accept_thread_ = std::thread([=] { RunAccept(reactor_sp_vec); });
+  accept_thread_ = std::thread([=] { RunAccept(); });
 
   return Status::OK();
 }
 
 void ThreadServer::Stop() {
-  is_running_ = false;
+  is_accepting_ = false;
   accept_thread_.join();
+  Drain();
+
+  is_running_ = false;
+  for (std::shared_ptr<Reactor> &reactor_sp : reactor_sp_vec_) {
+    reactor_sp->Wakeup();
+  }
   for (std::thread &t : io_thread_vec_) t.join();
   io_thread_vec_.clear();
-  worker_pool_->Stop();
+  for (std::shared_ptr<Pool> &pool_sp : worker_pool_vec_) pool_sp->Stop();
+  // nothing runs any more, close the connections that outlived the drain,
+  // events already freed hold a closed socket
+  std::shared_ptr<Event> event_sp;
+  while (event_queue_->Pop(event_sp).Ok()) {
+    std::shared_ptr<Socket> socket_sp = event_sp->GetSocket();
+    if (socket_sp->GetFd() >= 0) socket_sp->Close();
+  }
+  reactor_sp_vec_.clear();
+  io_event_vec_.clear();
+  if (AdminService::GetDefaultInstance() == this) {
+    AdminService::SetDefaultInstance(nullptr);
+  }
+  CoarseClock::GetInstance()->Stop();
+
+  Logger *logger = Logger::GetDefaultInstance();
+  if (logger != nullptr) logger->Flush();
+  BinaryLogger *binary_logger = BinaryLogger::GetDefaultInstance();
+  if (binary_logger != nullptr) binary_logger->Flush();
 }
 
 void ThreadServer::RunIo(uint32_t thread_id,
                          std::shared_ptr<Reactor> reactor_sp) {
   Status s;
+  std::vector<uint32_t> cpu_vec;
+  if (!node_cpu_vec_.empty()) {
+    cpu_vec = node_cpu_vec_[GetNode(thread_id)];
+  } else if (!config_->GetIoCpuVec().empty()) {
+    const std::vector<uint32_t> &io_cpu_vec = config_->GetIoCpuVec();
+    cpu_vec.push_back(io_cpu_vec[thread_id % io_cpu_vec.size()]);
+  }
+  s = CpuAffinity::PinThread(cpu_vec);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("io thread %u pin error status code %d message %s",
+                    thread_id, s.Code(), s.Message());
+  }
+  Pool *pool = worker_pool_vec_[GetNode(thread_id)].get();
+  // only used on this thread to classify and shed requests before queueing
+  std::shared_ptr<Dispatcher> dispatcher_sp =
+      DispatcherFactory::GetDefaultInstance()->Build();
+  LimiterCache limiter_cache;
+  DispatchBatch batch;
+  batch.func_vec.resize(pool->GetLaneNum());
+  batch.admit_vec.resize(pool->GetLaneNum());
 
   while (is_running_) {
     std::vector<Event *> event_vec;
     s = reactor_sp->Wait(event_vec);
+    CoarseClock::GetInstance()->Tick();
     if (s.Code() == StatusCode::eRetry) continue;
     if (!s.Ok()) {
       WEBKIT_LOGERROR(
@@ -69,149 +206,608 @@ void ThreadServer::RunIo(uint32_t thread_id,
 
     WEBKIT_LOGDEBUG("thread %u epoll wait return %zu", thread_id,
                     event_vec.size());
+    io_event_vec_[thread_id]->Add(event_vec.size());
+    uint64_t wait_tick = TscClock::GetInstance()->Now();
     for (Event *event : event_vec) {
       if (event->IsBusy()) continue;
       if (event->IsReadyToRecv()) {
+        event->GetStageTrace()->Stamp(StageTrace::eStampRecvReady, wait_tick);
+        RecvEvent(event, pool, dispatcher_sp.get(), limiter_cache, batch);
+      } else if (event->IsReadyToSend()) {
         event->SetBusy(true);
-        s = worker_pool_->Submit([&] {
-          Status s;
+        event->GetStageTrace()->Stamp(StageTrace::eStampSendReady);
+        Pool::FuncType func = [this, event] { SendEvent(event); };
+        if (config_->IsWorkerAffinity()) {
+          s = pool->Submit(GetAffinityKey(event), std::move(func));
+        } else {
+          s = pool->TrySubmit(std::move(func));
+        }
+        // a full pool must not stall the io thread, sending is short
+        if (s.Code() == StatusCode::ePoolFull) {
+          SendEvent(event);
+        } else if (!s.Ok()) {
+          WEBKIT_LOGERROR("worker pool submit error status code %d message %s",
+                          s.Code(), s.Message());
+          FreeEvent(event->shared_from_this());
+        }
+      } else if (event->IsReadyToReap()) {
+        ReapEvent(event);
+      } else {
+        WEBKIT_LOGERROR("event return error event");
+        FreeEvent(event->shared_from_this());
+      }
+    }
+    SubmitDispatch(pool, dispatcher_sp.get(), batch);
+  }
+}
 
-          s = event->Recv();
-          if (!s.Ok()) {
-            WEBKIT_LOGERROR("event recv error status code %d message %s",
-                            s.Code(), s.Message());
-            FreeEvent(event->shared_from_this());
-            return;
-          }
+void ThreadServer::RecvEvent(Event *event, Pool *pool,
+                             Dispatcher *dispatcher,
+                             LimiterCache &limiter_cache,
+                             DispatchBatch &batch) {
+  StageTrace *stage_trace = event->GetStageTrace();
+  stage_trace->Stamp(StageTrace::eStampRecvStart);
+  Status s = event->Recv();
+  if (s.Code() == StatusCode::eRetry) return;
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("event recv error status code %d message %s", s.Code(),
+                    s.Message());
+    FreeEvent(event->shared_from_this());
+    return;
+  }
+  stage_trace->Stamp(StageTrace::eStampRecvEnd);
+  inflight_num_.fetch_add(1, std::memory_order_relaxed);
 
-          std::shared_ptr<Dispatcher> dispatcher_sp =
-              DispatcherFactory::GetDefaultInstance()->Build();
-          s = dispatcher_sp->Dispatch(event->GetPacket().get());
-          if (s.Code() == StatusCode::eRetry) {
-            WEBKIT_LOGDEBUG("dispatcher packet need more data");
-            return;
-          }
-          if (!s.Ok()) {
-            WEBKIT_LOGERROR("dispacher error status code %d message %s",
-                            s.Code(), s.Message());
-            FreeEvent(event->shared_from_this());
-            return;
-          }
+  uint32_t method_id = 0;
+  s = dispatcher->Peek(event->GetPacket().get(), method_id);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("dispatcher peek error status code %d message %s",
+                    s.Code(), s.Message());
+    FreeEvent(event->shared_from_this());
+    return;
+  }
 
-          event->ClearEvent();
-          event->SetReadyToSend();
-          s = event->ModInReactor();
-          if (!s.Ok()) {
-            WEBKIT_LOGERROR("reactor modify error status code %d message %s",
-                            s.Code(), s.Message());
-            FreeEvent(event->shared_from_this());
-            return;
-          }
-          event->SetBusy(false);
-        });
-      } else if (event->IsReadyToSend()) {
-        event->SetBusy(true);
-        s = worker_pool_->Submit([&] {
-          Status s;
+  GradientLimiter *limiter = nullptr;
+  if (admission_controller_ != nullptr && method_id != kAdminMethodId) {
+    auto iter = limiter_cache.find(method_id);
+    if (iter != limiter_cache.end()) {
+      limiter = iter->second;
+    } else if (dispatcher->HasMethod(method_id)) {
+      limiter = admission_controller_->GetLimiter(method_id);
+      limiter_cache.emplace(method_id, limiter);
+    } else {
+      // any id a peer makes up shares one limiter and is never cached, so
+      // it takes nothing from the methods served
+      limiter = admission_controller_->GetUnknownLimiter();
+    }
+    if (!limiter->TryAcquire()) {
+      RejectEvent(event, dispatcher);
+      return;
+    }
+  }
 
-          s = event->Send();
-          if (!s.Ok()) {
-            WEBKIT_LOGERROR("event send error status code %d message %s",
-                            s.Code(), s.Message());
-          }
+  // admin requests jump the queue so the server can be inspected under load
+  uint32_t lane =
+      method_id == kAdminMethodId ? 0 : config_->GetMethodLane(method_id);
+  if (lane >= batch.func_vec.size()) lane = batch.func_vec.size() - 1;
+  uint64_t admit_tick = TscClock::GetInstance()->Now();
+  event->SetBusy(true);
+  if (config_->IsWorkerAffinity()) {
+    s = pool->Submit(GetAffinityKey(event),
+                     [this, event, limiter, admit_tick] {
+                       DispatchEvent(event, limiter, admit_tick);
+                     });
+    if (s.Ok()) return;
+    event->SetBusy(false);
+    if (limiter != nullptr) limiter->Cancel();
+    if (s.Code() == StatusCode::ePoolFull) {
+      RejectEvent(event, dispatcher);
+      return;
+    }
+    WEBKIT_LOGERROR("worker pool submit error status code %d message %s",
+                    s.Code(), s.Message());
+    FreeEvent(event->shared_from_this());
+    return;
+  }
+  batch.func_vec[lane].emplace_back([this, event, limiter, admit_tick] {
+    DispatchEvent(event, limiter, admit_tick);
+  });
+  batch.admit_vec[lane].emplace_back(event, limiter);
+}
 
-          FreeEvent(event->shared_from_this());
-        });
+void ThreadServer::SubmitDispatch(Pool *pool, Dispatcher *dispatcher,
+                                  DispatchBatch &batch) {
+  for (uint32_t lane = 0; lane < batch.func_vec.size(); lane++) {
+    std::vector<Pool::FuncType> &func_vec = batch.func_vec[lane];
+    std::vector<std::pair<Event *, GradientLimiter *>> &admit_vec =
+        batch.admit_vec[lane];
+    if (func_vec.empty()) continue;
+    size_t submit_num = 0;
+    Status s =
+        pool->SubmitN(lane, func_vec.data(), func_vec.size(), submit_num);
+    if (!s.Ok() && s.Code() != StatusCode::ePoolFull) {
+      WEBKIT_LOGERROR("worker pool submit error status code %d message %s",
+                      s.Code(), s.Message());
+    }
+    for (size_t i = submit_num; i < admit_vec.size(); i++) {
+      Event *event = admit_vec[i].first;
+      GradientLimiter *limiter = admit_vec[i].second;
+      event->SetBusy(false);
+      if (limiter != nullptr) limiter->Cancel();
+      if (s.Code() == StatusCode::ePoolFull) {
+        RejectEvent(event, dispatcher);
       } else {
-        WEBKIT_LOGERROR("event return error event");
         FreeEvent(event->shared_from_this());
       }
     }
+    func_vec.clear();
+    admit_vec.clear();
   }
 }
 
-void ThreadServer::RunAccept(
-    std::vector<std::shared_ptr<Reactor>> reactor_sp_vec) {
-  Status s;
-
-  TcpSocket socket;
-  s = socket.Listen(config_->GetIp(), config_->GetPort());
+void ThreadServer::DispatchEvent(Event *event, GradientLimiter *limiter,
+                                 uint64_t admit_tick) {
+  StageTrace *stage_trace = event->GetStageTrace();
+  stage_trace->Stamp(StageTrace::eStampDispatchStart);
+  // the time left a request carries also runs while it waits for a worker
+  TraceHelper *trace_helper = TraceHelper::GetInstance();
+  uint64_t queue_ms =
+      stage_trace->GetStageNs(StageTrace::eStampDispatchStart) / 1000000;
+  trace_helper->SetRecvMs(CoarseClock::GetInstance()->NowMs() - queue_ms);
+  std::shared_ptr<Dispatcher> dispatcher_sp =
+      DispatcherFactory::GetDefaultInstance()->Build();
+  Status s = dispatcher_sp->Dispatch(event->GetPacket().get());
+  trace_helper->SetRecvMs(0);
+  if (limiter != nullptr) {
+    TscClock *tsc_clock = TscClock::GetInstance();
+    limiter->Release(tsc_clock->ToNs(tsc_clock->Now() - admit_tick) / 1000);
+  }
+  if (s.Code() == StatusCode::eRetry) {
+    WEBKIT_LOGDEBUG("dispatcher packet need more data");
+    return;
+  }
   if (!s.Ok()) {
-    WEBKIT_LOGFATAL("socket listen error status code %d message %s", s.Code(),
+    WEBKIT_LOGERROR("dispacher error status code %d message %s", s.Code(),
                     s.Message());
+    FreeEvent(event->shared_from_this());
     return;
   }
+  stage_trace->Stamp(StageTrace::eStampDispatchEnd);
+  *event->GetTraceContext() = TraceHelper::GetInstance()->GetContext();
 
-  size_t cur_reactor_idx = 0;
-  while (is_running_) {
-    auto cli_socket_sp = std::make_shared<TcpSocket>();
-    s = socket.Accept(cli_socket_sp.get());
-    if (!s.Ok()) {
-      if (s.Code() != StatusCode::eRetry) {
-        WEBKIT_LOGERROR("socket accept error status code %d message %s",
-                        s.Code(), s.Message());
-      }
-      continue;
+  event->ClearEvent();
+  event->SetReadyToSend();
+  RearmEvent(event);
+}
+
+void ThreadServer::RejectEvent(Event *event, Dispatcher *dispatcher) {
+  overload_reject_->Add();
+  Status s = dispatcher->Reject(event->GetPacket().get(),
+                                StatusCode::eServerOverloaded);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("dispatcher reject error status code %d message %s",
+                    s.Code(), s.Message());
+    FreeEvent(event->shared_from_this());
+    return;
+  }
+  *event->GetTraceContext() = TraceHelper::GetInstance()->GetContext();
+
+  event->ClearEvent();
+  event->SetReadyToSend();
+  // rejects are answered on the io thread already
+  ModifyEvent(event);
+}
+
+void ThreadServer::SendEvent(Event *event) {
+  StageTrace *stage_trace = event->GetStageTrace();
+  stage_trace->Stamp(StageTrace::eStampSendStart);
+  TraceHelper::GetInstance()->SetContext(*event->GetTraceContext());
+
+  Status s = event->Send();
+  if (s.Code() == StatusCode::eRetry) {
+    // the socket buffer is full, the rest goes once there is room again
+    event->ClearEvent();
+    event->SetReadyToResume();
+    RearmEvent(event);
+    return;
+  } else if (!s.Ok()) {
+    WEBKIT_LOGERROR("event send error status code %d message %s", s.Code(),
+                    s.Message());
+  } else {
+    s = event->Reap();
+    if (s.Code() == StatusCode::eRetry) {
+      // the kernel still sends from the packet, the connection and its
+      // packet are released once the io thread reaped the completions
+      event->ClearEvent();
+      event->SetReadyToReap();
+      RearmEvent(event);
+      return;
+    } else if (!s.Ok()) {
+      WEBKIT_LOGERROR("event reap error status code %d message %s", s.Code(),
+                      s.Message());
+    } else {
+      stage_trace->Stamp(StageTrace::eStampSendEnd);
+      RecordStageTrace(event);
     }
-    s = cli_socket_sp->SetNonBlock();
+  }
+
+  FreeEvent(event->shared_from_this());
+}
+
+void ThreadServer::RearmEvent(Event *event) {
+  Status s = event->PostToReactor([this, event] { ModifyEvent(event); });
+  if (!s.Ok()) ModifyEvent(event);
+}
+
+void ThreadServer::ModifyEvent(Event *event) {
+  // only the first modify of a request, the one arming it for the reply,
+  // is a stage, later ones resume a send already stamped
+  StageTrace *stage_trace = event->GetStageTrace();
+  if (!stage_trace->HasStamp(StageTrace::eStampModifyStart)) {
+    stage_trace->Stamp(StageTrace::eStampModifyStart);
+  }
+  // the event may be reported as soon as it is modified, so it must not
+  // look busy by then, nor be stamped after
+  event->SetBusy(false);
+  Status s = event->ModInReactor();
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("reactor modify error status code %d message %s",
+                    s.Code(), s.Message());
+    FreeEvent(event->shared_from_this());
+  }
+}
+
+void ThreadServer::ReapEvent(Event *event) {
+  Status s = event->Reap();
+  if (s.Code() == StatusCode::eRetry) return;
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("event reap error status code %d message %s", s.Code(),
+                    s.Message());
+  } else {
+    event->GetStageTrace()->Stamp(StageTrace::eStampSendEnd);
+    RecordStageTrace(event);
+  }
+  FreeEvent(event->shared_from_this());
+}
+
+void ThreadServer::Drain() {
+  uint64_t deadline_ns = TscClock::MonotonicNs() +
+                         config_->GetDrainTimeoutMs() * 1000000UL;
+  size_t connection_num = GetConnectionNum();
+  while (connection_num > 0 && TscClock::MonotonicNs() < deadline_ns) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    connection_num = GetConnectionNum();
+  }
+  if (connection_num > 0) {
+    WEBKIT_LOGERROR(
+        "server drain timeout, %zu connections with %ld requests in flight "
+        "are closed",
+        connection_num, inflight_num_.load());
+  }
+}
+
+size_t ThreadServer::GetConnectionNum() const {
+  size_t connection_num = 0;
+  for (const std::shared_ptr<Reactor> &reactor_sp : reactor_sp_vec_) {
+    connection_num += reactor_sp->GetEventNum();
+  }
+  return connection_num;
+}
+
+Status ThreadServer::OpenListener(TcpSocket &tcp_socket,
+                                  UnixSocket &unix_socket,
+                                  UnixSocket &shm_socket) {
+  // the previous process passes its tcp listener first, then its unix
+  // listeners, which are told apart by path
+  std::vector<int> fd_vec;
+  const std::string &handoff_path = config_->GetHandoffPath();
+  if (!handoff_path.empty()) ListenerHandoff::Fetch(handoff_path, fd_vec);
+
+  Status s;
+  if (fd_vec.size() > 0) {
+    s = tcp_socket.Attach(fd_vec[0]);
     if (!s.Ok()) {
-      WEBKIT_LOGERROR(
-          "client socket %s:%d set non block error status code %d message %s",
-          cli_socket_sp->GetIp(), cli_socket_sp->GetPort(), s.Code(),
-          s.Message());
-      continue;
+      close(fd_vec[0]);
+    } else {
+      WEBKIT_LOGINFO("take over listening socket %s:%d fd %d",
+                     tcp_socket.GetIp(), tcp_socket.GetPort(),
+                     tcp_socket.GetFd());
     }
-    s = cli_socket_sp->SetTimeout(config_->GetSockTimeoutSec());
-    if (!s.Ok()) {
-      WEBKIT_LOGERROR("socket set timeout error status code %d message %s",
-                      s.Code(), s.Message());
+  } else {
+    s = tcp_socket.Listen(config_->GetIp(), config_->GetPort(),
+                          config_->GetSocketOption());
+  }
+  if (s.Ok()) s = tcp_socket.SetNonBlock();
+
+  for (size_t i = 1; i < fd_vec.size(); i++) {
+    std::string path = UnixSocket::GetSockPath(fd_vec[i]);
+    UnixSocket *listen_socket = nullptr;
+    if (!path.empty() && path == config_->GetUnixPath()) {
+      listen_socket = &unix_socket;
+    } else if (!path.empty() && path == config_->GetShmPath()) {
+      listen_socket = &shm_socket;
+    }
+    if (listen_socket == nullptr || !listen_socket->Attach(fd_vec[i]).Ok()) {
+      close(fd_vec[i]);
       continue;
     }
+    WEBKIT_LOGINFO("take over listening socket %s fd %d", path,
+                   listen_socket->GetFd());
+  }
 
-    if (event_queue_->IsFull()) {
-      WEBKIT_LOGFATAL(
-          "server current connection reaches max limit %u, new connect is "
-          "dropped, client %s:%d",
-          config_->GetMaxConnection(), cli_socket_sp->GetIp(),
-          cli_socket_sp->GetPort());
-      cli_socket_sp->Close();
-      continue;
+  if (s.Ok() && !config_->GetUnixPath().empty()) {
+    if (!unix_socket.IsConnected()) {
+      s = unix_socket.Listen(config_->GetUnixPath());
+    }
+    if (s.Ok()) s = unix_socket.SetNonBlock();
+  }
+  if (s.Ok() && !config_->GetShmPath().empty()) {
+    if (!shm_socket.IsConnected()) {
+      s = shm_socket.Listen(config_->GetShmPath());
     }
+    if (s.Ok()) s = shm_socket.SetNonBlock();
+  }
+  return s;
+}
 
-    std::shared_ptr<Reactor> reactor_sp = reactor_sp_vec[cur_reactor_idx];
-    cur_reactor_idx = (cur_reactor_idx + 1) % reactor_sp_vec.size();
+void ThreadServer::AddConnection(std::shared_ptr<StreamSocket> cli_socket_sp,
+                                 size_t &cur_reactor_idx) {
+  Status s = cli_socket_sp->SetNonBlock();
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR(
+        "client socket fd %d set non block error status code %d message %s",
+        cli_socket_sp->GetFd(), s.Code(), s.Message());
+    return;
+  }
+  s = cli_socket_sp->SetTimeout(config_->GetSockTimeoutSec());
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("socket set timeout error status code %d message %s",
+                    s.Code(), s.Message());
+    return;
+  }
 
-    std::shared_ptr<Event> event_sp;
-    s = event_free_queue_->Pop(event_sp);
+  if (event_queue_->IsFull()) {
+    WEBKIT_LOGFATAL(
+        "server current connection reaches max limit %u, new connect is "
+        "dropped, client fd %d",
+        config_->GetMaxConnection(), cli_socket_sp->GetFd());
+    connection_drop_->Add();
+    cli_socket_sp->Close();
+    return;
+  }
+
+  size_t reactor_idx = cur_reactor_idx;
+  cur_reactor_idx = (cur_reactor_idx + 1) % reactor_sp_vec_.size();
+  std::shared_ptr<Reactor> reactor_sp = reactor_sp_vec_[reactor_idx];
+
+  std::shared_ptr<Event> event_sp;
+  s = event_free_queue_->Pop(event_sp);
+  if (!s.Ok()) {
+    // a freed event stays on its reactor, so a packet is only taken here,
+    // from those built on the node of the reactor
+    std::shared_ptr<Packet> packet_sp;
+    if (node_packet_queue_vec_.empty() ||
+        !node_packet_queue_vec_[GetNode(reactor_idx)]->Pop(packet_sp).Ok()) {
+      packet_sp = PacketFactory::GetDefaultInstance()->Build();
+    }
+    event_sp = reactor_sp->CreateEvent(cli_socket_sp, packet_sp);
+    s = event_queue_->Push(event_sp);
     if (!s.Ok()) {
-      auto packet_sp = PacketFactory::GetDefaultInstance()->Build();
-      event_sp = reactor_sp->CreateEvent(cli_socket_sp, packet_sp);
-      s = event_queue_->Push(event_sp);
-      if (!s.Ok()) {
-        WEBKIT_LOGERROR(
-            "server event queue new connection push error status code %d "
-            "message %s",
-            s.Code(), s.Message());
-        continue;
-      }
-    } else {
-      event_sp->SetSocket(cli_socket_sp);
-      event_sp->ClearEvent();
+      WEBKIT_LOGERROR(
+          "server event queue new connection push error status code %d "
+          "message %s",
+          s.Code(), s.Message());
+      return;
     }
+  } else {
+    event_sp->SetSocket(cli_socket_sp);
+    event_sp->ClearEvent();
+  }
 
-    WEBKIT_LOGDEBUG("accept client %s:%d fd %d", cli_socket_sp->GetIp(),
-                    cli_socket_sp->GetPort(), cli_socket_sp->GetFd());
-    event_sp->SetReadyToRecv();
-    s = event_sp->AddToReactor();
+  WEBKIT_LOGDEBUG("accept client fd %d", cli_socket_sp->GetFd());
+  event_sp->GetStageTrace()->Reset();
+  *event_sp->GetTraceContext() = TraceContext{};
+  event_sp->GetStageTrace()->Stamp(StageTrace::eStampAccept);
+  event_sp->SetReadyToRecv();
+  connection_num_->Add(1);
+  // registered by the io thread of the reactor, so only that thread ever
+  // changes its epoll set, here only if its task queue is full
+  auto add_func = [this, event_sp] {
+    Status s = event_sp->AddToReactor();
     if (!s.Ok()) {
       WEBKIT_LOGERROR("event add to reactor error status code %d message %s",
                       s.Code(), s.Message());
       FreeEvent(event_sp);
-      continue;
     }
+  };
+  s = event_sp->PostToReactor(add_func);
+  if (!s.Ok()) add_func();
+}
+
+void ThreadServer::RunAccept() {
+  Status s;
+
+  TcpSocket tcp_socket;
+  UnixSocket unix_socket;
+  UnixSocket shm_socket;
+  s = OpenListener(tcp_socket, unix_socket, shm_socket);
+  if (!s.Ok()) {
+    WEBKIT_LOGFATAL("socket listen error status code %d message %s", s.Code(),
+                    s.Message());
+    return;
+  }
+
+  ListenerHandoff handoff;
+  if (!config_->GetHandoffPath().empty()) {
+    s = handoff.Listen(config_->GetHandoffPath());
+    if (!s.Ok()) {
+      WEBKIT_LOGERROR("listener handoff error status code %d message %s",
+                      s.Code(), s.Message());
+    }
+  }
+
+  size_t cur_reactor_idx = 0;
+  bool is_sock_busy_poll = config_->GetSockBusyPollUs() > 0;
+  bool is_zerocopy = config_->GetZeroCopyThreshold() > 0;
+  // poll skips a negative fd, so unused slots are inert
+  struct pollfd pollfd_arr[4];
+  while (is_accepting_) {
+    pollfd_arr[0] = {tcp_socket.GetFd(), POLLIN, 0};
+    pollfd_arr[1] = {unix_socket.GetFd(), POLLIN, 0};
+    pollfd_arr[2] = {shm_socket.GetFd(), POLLIN, 0};
+    pollfd_arr[3] = {handoff.GetFd(), POLLIN, 0};
+    if (poll(pollfd_arr, 4, kAcceptPollMs) <= 0) continue;
+
+    if (pollfd_arr[3].revents & POLLIN) {
+      std::vector<int> fd_vec = {tcp_socket.GetFd()};
+      if (unix_socket.IsConnected()) fd_vec.push_back(unix_socket.GetFd());
+      if (shm_socket.IsConnected()) fd_vec.push_back(shm_socket.GetFd());
+      s = handoff.Handoff(fd_vec);
+      if (s.Ok()) {
+        WEBKIT_LOGINFO("listening socket handed off, stop accepting");
+        is_handed_off_ = true;
+        is_accepting_ = false;
+        break;
+      }
+      WEBKIT_LOGERROR("listener handoff error status code %d message %s",
+                      s.Code(), s.Message());
+    }
+
+    if (pollfd_arr[0].revents & POLLIN) {
+      auto cli_socket_sp = std::make_shared<TcpSocket>();
+      s = tcp_socket.Accept(cli_socket_sp.get());
+      if (s.Ok()) s = cli_socket_sp->SetOption(config_->GetSocketOption());
+      if (s.Ok()) {
+        if (is_zerocopy) {
+          // an old kernel, replies are copied as before
+          s = cli_socket_sp->SetZeroCopy(config_->GetZeroCopyThreshold());
+          if (!s.Ok()) {
+            WEBKIT_LOGERROR(
+                "socket set zero copy error status code %d message %s",
+                s.Code(), s.Message());
+            is_zerocopy = false;
+          }
+        }
+        if (is_sock_busy_poll) {
+          // usually missing privileges, the connection still works so keep
+          // it and stop trying
+          s = cli_socket_sp->SetBusyPoll(config_->GetSockBusyPollUs());
+          if (!s.Ok()) {
+            WEBKIT_LOGERROR(
+                "socket set busy poll error status code %d message %s",
+                s.Code(), s.Message());
+            is_sock_busy_poll = false;
+          }
+        }
+        AddConnection(cli_socket_sp, cur_reactor_idx);
+      } else if (s.Code() != StatusCode::eRetry) {
+        WEBKIT_LOGERROR("socket accept error status code %d message %s",
+                        s.Code(), s.Message());
+      }
+    }
+
+    if (pollfd_arr[1].revents & POLLIN) {
+      auto cli_socket_sp = std::make_shared<UnixSocket>();
+      s = unix_socket.Accept(cli_socket_sp.get());
+      if (s.Ok()) {
+        AddConnection(cli_socket_sp, cur_reactor_idx);
+      } else if (s.Code() != StatusCode::eRetry) {
+        WEBKIT_LOGERROR("socket accept error status code %d message %s",
+                        s.Code(), s.Message());
+      }
+    }
+
+    if (pollfd_arr[2].revents & POLLIN) {
+      auto cli_socket_sp = std::make_shared<ShmSocket>();
+      s = shm_socket.Accept(cli_socket_sp.get());
+      if (s.Ok()) s = cli_socket_sp->Handshake(config_->GetShmRingSize());
+      if (s.Ok()) {
+        AddConnection(cli_socket_sp, cur_reactor_idx);
+      } else if (s.Code() != StatusCode::eRetry) {
+        WEBKIT_LOGERROR("shm socket accept error status code %d message %s",
+                        s.Code(), s.Message());
+      }
+    }
+  }
+
+  tcp_socket.Close();
+  for (UnixSocket *listen_socket : {&unix_socket, &shm_socket}) {
+    if (!listen_socket->IsConnected()) continue;
+    // after a handoff the path is served by the next process
+    if (!is_handed_off_) unlink(listen_socket->GetPath().c_str());
+    listen_socket->Close();
+  }
+}
+
+void ThreadServer::RunOnNode(uint32_t idx,
+                             const std::function<void()> &func) {
+  if (node_cpu_vec_.empty()) {
+    func();
+    return;
+  }
+  Status s = CpuAffinity::RunOn(node_cpu_vec_[GetNode(idx)], func);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("run on numa node %u error status code %d message %s",
+                    GetNode(idx), s.Code(), s.Message());
   }
+}
 
-  socket.Close();
+void ThreadServer::RecordStageTrace(Event *event) {
+  const StageTrace *stage_trace = event->GetStageTrace();
+  stage_trace->Record();
+  uint64_t threshold_us = config_->GetSlowRequestThresholdUs();
+  if (threshold_us == 0 || stage_trace->GetTotalNs() < threshold_us * 1000) {
+    return;
+  }
+  SlowRequestRecorder::GetInstance()->Add(*stage_trace,
+                                          event->GetSocket()->GetFd());
+}
+
+Status ThreadServer::Handle(const std::string &req, std::string &rsp) {
+  if (req == kAdminSlowRequest) {
+    rsp = SlowRequestRecorder::GetInstance()->Dump();
+    return Status::OK();
+  }
+
+  rsp.clear();
+  for (size_t i = 0; i < reactor_sp_vec_.size(); i++) {
+    rsp += fmt::sprintf("io.%zu.connection %zu\n", i,
+                        reactor_sp_vec_[i]->GetEventNum());
+  }
+  rsp += fmt::sprintf("server.inflight %ld\n", inflight_num_.load());
+  rsp += fmt::sprintf("event.total %zu\n", event_queue_->Size());
+  rsp += fmt::sprintf("event.free %zu\n", event_free_queue_->Size());
+  size_t task_num = 0;
+  uint32_t busy_num = 0;
+  std::vector<size_t> lane_task_vec;
+  for (std::shared_ptr<Pool> &pool_sp : worker_pool_vec_) {
+    task_num += pool_sp->GetTaskNum();
+    busy_num += pool_sp->GetBusyNum();
+    lane_task_vec.resize(pool_sp->GetLaneNum());
+    for (uint32_t i = 0; i < pool_sp->GetLaneNum(); i++) {
+      lane_task_vec[i] += pool_sp->GetLaneTaskNum(i);
+    }
+  }
+  rsp += fmt::sprintf("worker.task %zu\n", task_num);
+  for (size_t i = 0; i < lane_task_vec.size(); i++) {
+    rsp += fmt::sprintf("worker.lane.%zu.task %zu\n", i, lane_task_vec[i]);
+  }
+  rsp += fmt::sprintf("worker.busy %u/%zu\n", busy_num,
+                      config_->GetWorkerThreadNum() * worker_pool_vec_.size());
+
+  Logger *logger = Logger::GetDefaultInstance();
+  rsp += fmt::sprintf("log.drop %lu\n",
+                      logger == nullptr ? 0 : logger->GetDropCount());
+  BinaryLogger *binary_logger = BinaryLogger::GetDefaultInstance();
+  rsp += fmt::sprintf(
+      "binary_log.drop %lu\n",
+      binary_logger == nullptr ? 0 : binary_logger->GetDropCount());
+
+  if (admission_controller_ != nullptr) {
+    rsp += admission_controller_->ToString();
+  }
+  rsp += MetricsRegistry::GetInstance()->Snapshot().ToString();
+  return Status::OK();
 }
 
 Status ThreadServer::FreeEvent(std::shared_ptr<Event> event_sp) {
@@ -230,7 +826,15 @@ Status ThreadServer::FreeEvent(std::shared_ptr<Event> event_sp) {
                     s.Code(), s.Message());
     return s;
   }
+  // unsent data and files of a failed reply are dropped
+  event_sp->GetPacket()->Clear();
   event_sp->SetBusy(false);
+  connection_num_->Sub(1);
+  StageTrace *stage_trace = event_sp->GetStageTrace();
+  if (stage_trace->HasStamp(StageTrace::eStampRecvEnd)) {
+    inflight_num_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  stage_trace->Reset();
 
   s = event_free_queue_->Push(event_sp);
   if (!s.Ok()) {
@@ -1,15 +1,30 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "metrics/metrics.h"
 #include "util/circular_queue.h"
+#include "webkit/admin_service.h"
+#include "webkit/dispatcher.h"
 #include "webkit/event.h"
 #include "webkit/pool.h"
 #include "webkit/reactor.h"
 #include "webkit/server_config.h"
 
 namespace webkit {
-class ThreadServer {
+class AdmissionController;
+class GradientLimiter;
+class StreamSocket;
+class TcpSocket;
+class UnixSocket;
+
+class ThreadServer : public AdminService {
  public:
   ThreadServer(const ServerConfig *config);
 
@@ -19,21 +34,120 @@ class ThreadServer {
 
   Status Run();
 
+  // stop accepting, wait up to the drain timeout for accepted connections
+  // to be answered, then stop the threads and close what is left
   void Stop();
 
+  // the listening socket went to a new process which accepts from now on,
+  // the caller should Stop this one to drain it
+  bool IsHandedOff() const { return is_handed_off_; }
+
+  // worker pool of the first node, valid after Init, callers in this
+  // process can dispatch on it, see InProcChannel
+  Pool *GetWorkerPool() const { return worker_pool_vec_[0].get(); }
+
+  // dump runtime state, served for kAdminMethodId requests, a
+  // kAdminSlowRequest request dumps the slow request recorder instead
+  Status Handle(const std::string &req, std::string &rsp) override;
+
  private:
+  using LimiterCache = std::unordered_map<uint32_t, GradientLimiter *>;
+
+  // dispatches admitted during one reactor wait, per lane, submitted together
+  // so the workers are woken once per lane instead of once per request
+  struct DispatchBatch {
+    std::vector<std::vector<Pool::FuncType>> func_vec;
+    std::vector<std::vector<std::pair<Event *, GradientLimiter *>>> admit_vec;
+  };
+
   void RunIo(uint32_t thread_id, std::shared_ptr<Reactor> reactor_sp);
 
-  void RunAccept(std::vector<std::shared_ptr<Reactor>> reactor_sp_vec);
+  // read a request on the io thread, admit it and add its dispatch to batch
+  void RecvEvent(Event *event, Pool *pool, Dispatcher *dispatcher,
+                 LimiterCache &limiter_cache, DispatchBatch &batch);
+
+  // submit the batch, requests the pool has no room for are rejected
+  void SubmitDispatch(Pool *pool, Dispatcher *dispatcher,
+                      DispatchBatch &batch);
+
+  void DispatchEvent(Event *event, GradientLimiter *limiter,
+                     uint64_t admit_tick);
+
+  // answer with eServerOverloaded without queueing the request
+  void RejectEvent(Event *event, Dispatcher *dispatcher);
+
+  void SendEvent(Event *event);
+
+  // hand a busy event whose mask is set back to its reactor, the io thread
+  // modifies it, this thread only if its task queue is full
+  void RearmEvent(Event *event);
+
+  // on the io thread, let the reactor report event again
+  void ModifyEvent(Event *event);
+
+  // on the io thread, free the event once its zero copy sends completed
+  void ReapEvent(Event *event);
+
+  // an event serves one connection at a time, so its address identifies
+  // the connection for keyed submits
+  static uint64_t GetAffinityKey(Event *event) {
+    return reinterpret_cast<uintptr_t>(event);
+  }
+
+  void RunAccept();
+
+  // listen, or take over the listening sockets of the previous process,
+  // unix_socket and shm_socket are left closed when their path is not set
+  Status OpenListener(TcpSocket &tcp_socket, UnixSocket &unix_socket,
+                      UnixSocket &shm_socket);
+
+  // register an accepted connection with the next reactor
+  void AddConnection(std::shared_ptr<StreamSocket> cli_socket_sp,
+                     size_t &cur_reactor_idx);
+
+  // wait until every accepted connection is closed or the drain timeout
+  void Drain();
+
+  // connections registered with any reactor
+  size_t GetConnectionNum() const;
 
   Status FreeEvent(std::shared_ptr<Event> event_sp);
 
+  void RecordStageTrace(Event *event);
+
+  // numa node of io thread or reactor idx, 0 unless numa aware
+  uint32_t GetNode(uint32_t idx) const {
+    return node_cpu_vec_.empty() ? 0 : idx % node_cpu_vec_.size();
+  }
+
+  // run func with its first touch allocations on the node of reactor idx
+  void RunOnNode(uint32_t idx, const std::function<void()> &func);
+
   const ServerConfig *config_;
-  std::shared_ptr<Pool> worker_pool_;
+  // one pool per numa node, a single one unless numa aware, io thread i
+  // uses pool GetNode(i)
+  std::vector<std::shared_ptr<Pool>> worker_pool_vec_;
+  // cpus of every numa node, empty unless numa aware
+  std::vector<std::vector<uint32_t>> node_cpu_vec_;
+  // packets built on each numa node at Init for the connections of its
+  // reactors, empty unless numa aware
+  std::vector<std::unique_ptr<CircularQueue<std::shared_ptr<Packet>>>>
+      node_packet_queue_vec_;
   CircularQueue<std::shared_ptr<Event>> *event_queue_;
   CircularQueue<std::shared_ptr<Event>> *event_free_queue_;
   std::thread accept_thread_;
   std::vector<std::thread> io_thread_vec_;
-  bool is_running_;
+  std::vector<std::shared_ptr<Reactor>> reactor_sp_vec_;
+  std::vector<Counter *> io_event_vec_;
+  std::unique_ptr<AdmissionController> admission_controller_;
+  std::atomic<bool> is_running_;
+  std::atomic<bool> is_accepting_;
+  std::atomic<bool> is_handed_off_;
+  // requests fully received and not yet answered
+  std::atomic<int64_t> inflight_num_;
+
+  Gauge *connection_num_;
+  Counter *connection_drop_;
+  Counter *overload_reject_;
 };
 }  // namespace webkit
\ No newline at end of file
@@ -0,0 +1,357 @@
+#include "shm_socket.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "util/syscall.h"
+#include "webkit/logger.h"
+
+namespace webkit {
+static constexpr uint32_t kShmMagic = 0x77626b73;
+static constexpr uint32_t kShmVersion = 1;
+static constexpr size_t kShmHeaderSize = 4096;
+// the size is fixed once the rings are created, a peer truncating the
+// memfd would make the next ring access fault with SIGBUS
+static constexpr int kShmSealMask = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+// polls of the ring before sleeping on the doorbell, a peer on another cpu
+// usually answers within them, with one cpu the peer can not run meanwhile
+static constexpr uint32_t kShmSpinNum = 4096;
+static const bool IsShmSpin = std::thread::hardware_concurrency() > 1;
+
+// positions only grow, tail - head is the number of bytes in the ring, the
+// waiting flags tell the other side to ring the doorbell
+struct ShmRing {
+  alignas(64) std::atomic<uint64_t> tail;
+  std::atomic<uint32_t> is_producer_waiting;
+  alignas(64) std::atomic<uint64_t> head;
+  std::atomic<uint32_t> is_consumer_waiting;
+};
+
+// both processes map the same pages, so only address free atomics work
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<uint32_t>::is_always_lock_free);
+
+// ring 0 carries client to server bytes, ring 1 server to client bytes, the
+// data of both follows the header page
+struct ShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ring_size;
+  ShmRing ring_arr[2];
+};
+
+static_assert(sizeof(ShmHeader) <= kShmHeaderSize);
+
+ShmSocket::ShmSocket()
+    : header_(nullptr),
+      map_size_(0),
+      ring_size_(0),
+      tx_ring_(nullptr),
+      rx_ring_(nullptr),
+      tx_data_(nullptr),
+      rx_data_(nullptr),
+      is_peer_closed_(false) {}
+
+ShmSocket::~ShmSocket() {
+  if (is_connected_) Close();
+}
+
+Status ShmSocket::Connect(const std::string &path) {
+  Status s = UnixSocket::Connect(path);
+  if (!s.Ok()) return s;
+
+  std::vector<int> fd_vec;
+  s = Syscall::RecvFdVec(fd_, fd_vec);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("shm socket recv fd error status code %d message %s",
+                    s.Code(), s.Message());
+    UnixSocket::Close();
+    return s;
+  }
+  for (size_t i = 1; i < fd_vec.size(); i++) close(fd_vec[i]);
+  s = Map(fd_vec[0], false);
+  close(fd_vec[0]);
+  if (!s.Ok()) UnixSocket::Close();
+  return s;
+}
+
+Status ShmSocket::Handshake(size_t ring_size) {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("shm socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+
+  size_t round_size = 4096;
+  while (round_size < ring_size) round_size <<= 1;
+  int shm_fd = memfd_create("webkit_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (shm_fd < 0) {
+    WEBKIT_LOGERROR("shm socket memfd create error %d %s", errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eShmMapError, "memfd create error");
+  }
+  // pages of a fresh memfd read as zero, positions and flags start at 0
+  if (ftruncate(shm_fd, kShmHeaderSize + 2 * round_size) < 0) {
+    WEBKIT_LOGERROR("shm socket truncate error %d %s", errno, strerror(errno));
+    close(shm_fd);
+    return Status::Error(StatusCode::eShmMapError, "memfd truncate error");
+  }
+  auto *header = static_cast<ShmHeader *>(
+      mmap(nullptr, kShmHeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+           shm_fd, 0));
+  if (header == MAP_FAILED) {
+    WEBKIT_LOGERROR("shm socket mmap error %d %s", errno, strerror(errno));
+    close(shm_fd);
+    return Status::Error(StatusCode::eShmMapError, "mmap error");
+  }
+  header->magic = kShmMagic;
+  header->version = kShmVersion;
+  header->ring_size = round_size;
+  // nobody has read yet, so the first write of each side rings the doorbell
+  header->ring_arr[0].is_consumer_waiting = 1;
+  header->ring_arr[1].is_consumer_waiting = 1;
+  munmap(header, kShmHeaderSize);
+  if (fcntl(shm_fd, F_ADD_SEALS, kShmSealMask) < 0) {
+    WEBKIT_LOGERROR("shm socket seal error %d %s", errno, strerror(errno));
+    close(shm_fd);
+    return Status::Error(StatusCode::eShmMapError, "memfd seal error");
+  }
+
+  Status s = Map(shm_fd, true);
+  if (s.Ok()) s = Syscall::SendFdVec(fd_, {shm_fd});
+  close(shm_fd);
+  return s;
+}
+
+Status ShmSocket::Map(int shm_fd, bool is_server) {
+  // only a memfd whose size nobody can change any more is mapped
+  int seal_mask = fcntl(shm_fd, F_GET_SEALS);
+  struct stat st;
+  if (seal_mask < 0 || (seal_mask & kShmSealMask) != kShmSealMask ||
+      fstat(shm_fd, &st) < 0 ||
+      static_cast<size_t>(st.st_size) < kShmHeaderSize) {
+    WEBKIT_LOGERROR("shm socket invalid memfd %d", shm_fd);
+    return Status::Error(StatusCode::eShmMapError, "invalid memfd");
+  }
+  void *addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    shm_fd, 0);
+  if (addr == MAP_FAILED) {
+    WEBKIT_LOGERROR("shm socket mmap error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eShmMapError, "mmap error");
+  }
+
+  auto *header = static_cast<ShmHeader *>(addr);
+  uint64_t ring_size = header->ring_size;
+  if (header->magic != kShmMagic || header->version != kShmVersion ||
+      ring_size == 0 || (ring_size & (ring_size - 1)) != 0 ||
+      ring_size > static_cast<size_t>(st.st_size) ||
+      kShmHeaderSize + 2 * ring_size != static_cast<size_t>(st.st_size)) {
+    WEBKIT_LOGERROR("shm socket header mismatch version %u ring size %lu",
+                    header->version, ring_size);
+    munmap(addr, st.st_size);
+    return Status::Error(StatusCode::eShmMapError, "shm header mismatch");
+  }
+
+  header_ = header;
+  map_size_ = st.st_size;
+  // the header stays writable by the peer, only the checked copy is used
+  ring_size_ = ring_size;
+  uint8_t *data = static_cast<uint8_t *>(addr) + kShmHeaderSize;
+  int tx_idx = is_server ? 1 : 0;
+  int rx_idx = 1 - tx_idx;
+  tx_ring_ = &header_->ring_arr[tx_idx];
+  rx_ring_ = &header_->ring_arr[rx_idx];
+  tx_data_ = data + tx_idx * ring_size;
+  rx_data_ = data + rx_idx * ring_size;
+  is_peer_closed_ = false;
+  return Status::OK();
+}
+
+template <typename F>
+Status ShmSocket::Produce(size_t size, size_t &produce_size, F &&copy) {
+  if (!is_connected_ || header_ == nullptr) {
+    WEBKIT_LOGERROR("shm socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  produce_size = 0;
+  while (produce_size < size) {
+    if (is_peer_closed_) {
+      return Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
+    }
+    uint64_t tail = tx_ring_->tail.load(std::memory_order_relaxed);
+    uint64_t head = tx_ring_->head.load(std::memory_order_acquire);
+    // the peer moves head, a position past tail means a corrupt ring
+    if (tail - head > ring_size_) return RingError();
+    size_t free_size = ring_size_ - (tail - head);
+    if (free_size == 0) {
+      Status s = Wait(tx_ring_, true);
+      if (!s.Ok()) return s;
+      continue;
+    }
+    size_t offset = tail & (ring_size_ - 1);
+    size_t copy_size = std::min({size - produce_size, free_size,
+                                 static_cast<size_t>(ring_size_ - offset)});
+    size_t done_size = 0;
+    Status s = copy(tx_data_ + offset, copy_size, done_size);
+    produce_size += done_size;
+    tx_ring_->tail.store(tail + done_size, std::memory_order_seq_cst);
+    Kick(tx_ring_, true);
+    if (!s.Ok() || done_size != copy_size) return s;
+  }
+  return Status::OK();
+}
+
+template <typename F>
+Status ShmSocket::Consume(size_t size, size_t &consume_size, F &&copy) {
+  if (!is_connected_ || header_ == nullptr) {
+    WEBKIT_LOGERROR("shm socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  consume_size = 0;
+  while (consume_size < size) {
+    uint64_t head = rx_ring_->head.load(std::memory_order_relaxed);
+    uint64_t tail = rx_ring_->tail.load(std::memory_order_acquire);
+    if (tail == head) {
+      Status s = Wait(rx_ring_, false);
+      if (!s.Ok()) return s;
+      continue;
+    }
+    // likewise the peer moves tail, more bytes than the ring holds would
+    // read past its data
+    if (tail - head > ring_size_) return RingError();
+    size_t offset = head & (ring_size_ - 1);
+    size_t copy_size = std::min({size - consume_size,
+                                 static_cast<size_t>(tail - head),
+                                 static_cast<size_t>(ring_size_ - offset)});
+    size_t done_size = 0;
+    Status s = copy(rx_data_ + offset, copy_size, done_size);
+    consume_size += done_size;
+    rx_ring_->head.store(head + done_size, std::memory_order_seq_cst);
+    Kick(rx_ring_, false);
+    if (!s.Ok() || done_size != copy_size) return s;
+  }
+  return Status::OK();
+}
+
+Status ShmSocket::Wait(ShmRing *ring, bool is_producer) {
+  auto is_ready = [&] {
+    uint64_t tail = ring->tail.load(std::memory_order_seq_cst);
+    uint64_t head = ring->head.load(std::memory_order_seq_cst);
+    return is_producer ? tail - head < ring_size_ : tail != head;
+  };
+  // a non blocking socket is served from the reactor thread, which must
+  // not spin while other connections wait on it
+  for (uint32_t i = 0; IsShmSpin && !is_nonblock_ && i < kShmSpinNum; i++) {
+    if (is_ready()) return Status::OK();
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  // flag first, then look at the ring again, the peer moves its position
+  // first, then looks at the flag, so one of the two sees the other
+  std::atomic<uint32_t> &is_waiting =
+      is_producer ? ring->is_producer_waiting : ring->is_consumer_waiting;
+  is_waiting.store(1, std::memory_order_seq_cst);
+  if (is_ready()) return Status::OK();
+
+  // blocks up to the socket timeout, or returns at once when non blocking,
+  // the reactor then waits for the doorbell to make the socket readable
+  char kick_arr[64];
+  ssize_t nread = recv(fd_, kick_arr, sizeof(kick_arr), 0);
+  if (nread > 0) return Status::OK();
+  if (nread == 0) {
+    // bytes the peer wrote before closing are still in the ring
+    is_peer_closed_ = true;
+    if (!is_producer && is_ready()) return Status::OK();
+    return Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
+  }
+  if (errno == EINTR) return Status::OK();
+  if (errno == EAGAIN) {
+    return is_producer ? Status::Warn(StatusCode::eRetry)
+                       : Status::Warn(StatusCode::eNoData);
+  }
+  WEBKIT_LOGERROR("shm socket doorbell error %d %s", errno, strerror(errno));
+  if (is_producer) {
+    return Status::Error(StatusCode::eSocketWriteError, "socket write error");
+  }
+  return Status::Error(StatusCode::eSocketReadError, "socket read error");
+}
+
+Status ShmSocket::RingError() {
+  WEBKIT_LOGERROR("shm socket ring corrupt by peer");
+  is_peer_closed_ = true;
+  return Status::Error(StatusCode::eShmRingError, "shm ring corrupt");
+}
+
+bool ShmSocket::IsWriteWaitReadable() const { return true; }
+
+void ShmSocket::Kick(ShmRing *ring, bool is_producer) {
+  std::atomic<uint32_t> &is_waiting =
+      is_producer ? ring->is_consumer_waiting : ring->is_producer_waiting;
+  if (is_waiting.load(std::memory_order_seq_cst) == 0) return;
+  if (is_waiting.exchange(0, std::memory_order_seq_cst) == 0) return;
+  // a full socket buffer already holds a wakeup, so drop it then
+  char kick = 0;
+  send(fd_, &kick, sizeof(kick), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+Status ShmSocket::Write(const void *src, size_t src_size,
+                        size_t &write_size) {
+  const uint8_t *p_src = static_cast<const uint8_t *>(src);
+  return Produce(src_size, write_size,
+                 [&](uint8_t *dst, size_t size, size_t &done_size) {
+                   memcpy(dst, p_src, size);
+                   p_src += size;
+                   done_size = size;
+                   return Status::OK();
+                 });
+}
+
+Status ShmSocket::Write(IoBase &src, size_t src_size, size_t &write_size) {
+  return Produce(src_size, write_size,
+                 [&](uint8_t *dst, size_t size, size_t &done_size) {
+                   return src.Read(dst, size, done_size);
+                 });
+}
+
+Status ShmSocket::Read(void *dst, size_t dst_size, size_t &read_size) {
+  uint8_t *p_dst = static_cast<uint8_t *>(dst);
+  return Consume(dst_size, read_size,
+                 [&](const uint8_t *src, size_t size, size_t &done_size) {
+                   memcpy(p_dst, src, size);
+                   p_dst += size;
+                   done_size = size;
+                   return Status::OK();
+                 });
+}
+
+Status ShmSocket::Read(IoBase &dst, size_t dst_size, size_t &read_size) {
+  return Consume(dst_size, read_size,
+                 [&](const uint8_t *src, size_t size, size_t &done_size) {
+                   return dst.Write(src, size, done_size);
+                 });
+}
+
+Status ShmSocket::Close() {
+  if (header_ != nullptr) {
+    munmap(header_, map_size_);
+    header_ = nullptr;
+    map_size_ = 0;
+    ring_size_ = 0;
+    tx_ring_ = nullptr;
+    rx_ring_ = nullptr;
+    tx_data_ = nullptr;
+    rx_data_ = nullptr;
+  }
+  return UnixSocket::Close();
+}
+}  // namespace webkit
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "socket/unix_socket.h"
+
+namespace webkit {
+struct ShmHeader;
+struct ShmRing;
+
+// same host connection whose bytes go through a pair of single producer
+// single consumer rings in a shared memfd mapping, one per direction, so a
+// payload is copied into the ring and out of it and never through the
+// kernel, the unix socket underneath carries the memfd on connect, then
+// only serves as doorbell, a byte is sent when the peer sleeps on an empty
+// or full ring, and reports the peer closing, GetFd returns it so the
+// reactor polls it like any socket
+class ShmSocket : public UnixSocket {
+ public:
+  ShmSocket();
+
+  ~ShmSocket();
+
+  // connect to a server accepting shm connections on path and map the
+  // rings it creates
+  Status Connect(const std::string &path);
+
+  // server side of the handshake on an accepted socket, create the rings,
+  // ring_size rounded up to a power of two, and pass them to the client
+  Status Handshake(size_t ring_size);
+
+  Status Write(const void *src, size_t src_size, size_t &write_size) override;
+
+  Status Write(IoBase &src, size_t src_size, size_t &write_size) override;
+
+  Status Read(void *dst, size_t dst_size, size_t &read_size) override;
+
+  Status Read(IoBase &dst, size_t dst_size, size_t &read_size) override;
+
+  Status Close() override;
+
+  // the peer rings the doorbell when it drained a full ring
+  bool IsWriteWaitReadable() const override;
+
+ private:
+  Status Map(int shm_fd, bool is_server);
+
+  template <typename F>
+  Status Produce(size_t size, size_t &produce_size, F &&copy);
+
+  template <typename F>
+  Status Consume(size_t size, size_t &consume_size, F &&copy);
+
+  // sleep on the doorbell until woken, OK means check the ring again
+  Status Wait(ShmRing *ring, bool is_producer);
+
+  // the peer moved a position out of the ring, nothing more is copied
+  Status RingError();
+
+  // wake the peer if it sleeps on ring
+  void Kick(ShmRing *ring, bool is_producer);
+
+  ShmHeader *header_;
+  size_t map_size_;
+  uint64_t ring_size_;
+  ShmRing *tx_ring_;
+  ShmRing *rx_ring_;
+  uint8_t *tx_data_;
+  uint8_t *rx_data_;
+  bool is_peer_closed_;
+};
+}  // namespace webkit
@@ -0,0 +1,321 @@
+#include "stream_socket.h"
+
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "util/syscall.h"
+#include "webkit/logger.h"
+
+namespace webkit {
+StreamSocket::StreamSocket()
+    : fd_(-1), is_connected_(false), is_nonblock_(false) {}
+
+StreamSocket::StreamSocket(int fd)
+    : fd_(fd), is_connected_(true), is_nonblock_(false) {}
+
+StreamSocket::~StreamSocket() {
+  if (is_connected_) Close();
+}
+
+Status StreamSocket::Close() {
+  if (!is_connected_) {
+    WEBKIT_LOGFATAL("socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  int ret = close(fd_);
+  if (ret != 0) {
+    WEBKIT_LOGERROR("socket close error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketCloseError, "socket close error");
+  }
+  fd_ = -1;
+  is_connected_ = false;
+  is_nonblock_ = false;
+  buffer_.clear();
+  return Status::OK();
+}
+
+Status StreamSocket::Write(const void *data, size_t data_size,
+                           size_t &write_size) {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  write_size = 0;
+  Status s = WriteFromBuffer(data_size, write_size);
+  if (!s.Ok()) return s;
+  while (write_size < data_size) {
+    ssize_t nwrite = write(fd_, data, data_size);
+    if (nwrite < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        return Status::Warn(StatusCode::eRetry);
+      }
+      WEBKIT_LOGERROR("socket write error %d %s", errno, strerror(errno));
+      return Status::Error(StatusCode::eSocketWriteError, "socket write error");
+    }
+    if (nwrite == 0) {  // no log error if peer closed
+      return Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
+    }
+    write_size += nwrite;
+  }
+  return Status::OK();
+}
+
+Status StreamSocket::Write(IoBase &src, size_t src_size,
+                           size_t &write_size) {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  write_size = 0;
+
+  Packet *packet = dynamic_cast<Packet *>(&src);
+  if (packet != nullptr && buffer_.empty()) {
+    return WriteFromPacket(*packet, src_size, write_size);
+  }
+
+  if (buffer_.size() < src_size) {
+    size_t write_pos = buffer_.size();
+    buffer_.resize(src_size);
+    size_t read_size = 0;
+    Status s = src.Read(&buffer_[write_pos], src_size - write_pos, read_size);
+    if (!s.Ok() || write_pos + read_size != src_size) {
+      WEBKIT_LOGERROR("read src expect %zu get %zu status code %d message %s",
+                      src_size - write_pos, read_size, s.Code(), s.Message());
+      return s;
+    }
+  }
+
+  Status s = WriteFromBuffer(src_size, write_size);
+  if (!s.Ok()) return s;
+
+  return Status::OK();
+}
+
+Status StreamSocket::Read(void *dst, size_t dst_size, size_t &read_size) {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  read_size = 0;
+  if (buffer_.size() != 0) {
+    size_t data_size = std::min(buffer_.size(), dst_size);
+    memcpy(dst, &buffer_[0], data_size);
+    BufferPop(data_size);
+    read_size = data_size;
+  }
+
+  while (read_size < dst_size) {
+    ssize_t nread = read(fd_, reinterpret_cast<uint8_t *>(dst) + read_size,
+                         dst_size - read_size);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        return Status::Warn(StatusCode::eNoData);
+      }
+      WEBKIT_LOGERROR("socket read error %d %s", errno, strerror(errno));
+      return Status::Error(StatusCode::eSocketReadError, "socket read error");
+    }
+    if (nread == 0) {  // no log error if peer closed
+      return Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
+    }
+    read_size += nread;
+  }
+
+  return Status::OK();
+}
+
+Status StreamSocket::Read(IoBase &dst, size_t dst_size, size_t &read_size) {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  read_size = 0;
+
+  if (buffer_.size() < dst_size) {
+    size_t data_size = dst_size - buffer_.size();
+    size_t write_size = 0;
+    Status s = ReadToBuffer(data_size, write_size);
+    if (!s.Ok()) return s;
+  }
+
+  Status s = dst.Write(&buffer_[0], dst_size, read_size);
+  BufferPop(read_size);
+  if (!s.Ok() || dst_size != read_size) {
+    WEBKIT_LOGERROR("write dst expect %zu get %zu status code %d message %s",
+                    dst_size, read_size, s.Code(), s.Message());
+    return s;
+  }
+
+  return Status::OK();
+}
+
+Status StreamSocket::SetNonBlock() {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+  Status s = Syscall::SetNonBlock(fd_);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("set non block error status code %d message %s", s.Code(),
+                    s.Message());
+    return s;
+  }
+  is_nonblock_ = true;
+  return Status::OK();
+}
+
+Status StreamSocket::SetTimeout(suseconds_t timeout_sec,
+                                suseconds_t timeout_us) {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+
+  int ret = 0;
+  struct timeval timeout;
+  timeout.tv_sec = timeout_sec;
+  timeout.tv_usec = timeout_us;
+
+  ret = setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  if (ret != 0) {
+    WEBKIT_LOGERROR("socket set recv timeout error %d %s", errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketOptError,
+                         "socket set sock opt error");
+  }
+
+  ret = setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  if (ret != 0) {
+    WEBKIT_LOGERROR("socket set send timeout error %d %s", errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketOptError,
+                         "socket set sock ope error");
+  }
+
+  return Status::OK();
+}
+
+Status StreamSocket::WriteFromPacket(Packet &packet, size_t data_size,
+                                     size_t &write_size) {
+  write_size = 0;
+  while (write_size < data_size) {
+    Packet::Span span = packet.GetSpan();
+    if (span.size == 0) {
+      WEBKIT_LOGERROR("packet expect %zu get %zu", data_size, write_size);
+      return Status::Error(StatusCode::eSocketWriteError, "packet too short");
+    }
+    size_t span_size = std::min(span.size, data_size - write_size);
+    size_t span_write_size = 0;
+    Status s;
+    if (span.data != nullptr) {
+      s = WriteSpan(span.data, span_size, span_write_size);
+    } else {
+      off_t offset = span.offset;
+      ssize_t nwrite = sendfile(fd_, span.fd, &offset, span_size);
+      if (nwrite > 0) {
+        span_write_size = nwrite;
+      } else if (nwrite < 0 && errno == EAGAIN) {
+        s = Status::Warn(StatusCode::eRetry);
+      } else if (nwrite < 0 && errno != EINTR) {
+        WEBKIT_LOGERROR("socket sendfile error %d %s", errno, strerror(errno));
+        s = Status::Error(StatusCode::eSocketWriteError, "socket write error");
+      } else if (nwrite == 0) {
+        WEBKIT_LOGERROR("socket sendfile fd %d ends early", span.fd);
+        s = Status::Error(StatusCode::eSocketWriteError, "socket write error");
+      }
+    }
+    packet.Consume(span_write_size);
+    write_size += span_write_size;
+    if (!s.Ok()) return s;
+  }
+  return Status::OK();
+}
+
+Status StreamSocket::WriteSpan(const void *data, size_t data_size,
+                               size_t &write_size) {
+  write_size = 0;
+  ssize_t nwrite = write(fd_, data, data_size);
+  if (nwrite < 0) {
+    if (errno == EINTR) return Status::OK();
+    if (errno == EAGAIN) return Status::Warn(StatusCode::eRetry);
+    WEBKIT_LOGERROR("socket write error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketWriteError, "socket write error");
+  }
+  write_size = nwrite;
+  return Status::OK();
+}
+
+int StreamSocket::GetFd() const { return fd_; }
+
+bool StreamSocket::IsConnected() const { return is_connected_; }
+
+Status StreamSocket::ReadToBuffer(size_t data_size, size_t &read_size) {
+  size_t write_pos = buffer_.size();
+  buffer_.resize(write_pos + data_size);
+
+  read_size = 0;
+  Status s = Status::OK();
+  while (read_size < data_size) {
+    ssize_t nread =
+        read(fd_, &buffer_[write_pos + read_size], data_size - read_size);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        s = Status::Warn(StatusCode::eNoData);
+        break;
+      }
+      WEBKIT_LOGERROR("socket read error %d %s", errno, strerror(errno));
+      s = Status::Error(StatusCode::eSocketReadError, "socket read error");
+      break;
+    }
+    if (nread == 0) {
+      s = Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
+      break;
+    }
+    read_size += nread;
+  }
+  // keep only the bytes actually read, a later call appends the rest
+  buffer_.resize(write_pos + read_size);
+
+  return s;
+}
+
+Status StreamSocket::WriteFromBuffer(size_t data_size, size_t &write_size) {
+  size_t read_size = std::min(buffer_.size(), data_size);
+
+  write_size = 0;
+  Status s = Status::OK();
+  while (write_size < read_size) {
+    ssize_t nwrite = write(fd_, &buffer_[write_size], read_size - write_size);
+    if (nwrite < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        s = Status::Warn(StatusCode::eRetry);
+        break;
+      }
+      WEBKIT_LOGERROR("socket write error %d %s", errno, strerror(errno));
+      s = Status::Error(StatusCode::eSocketWriteError, "socket write error");
+      break;
+    }
+    if (nwrite == 0) {
+      s = Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
+      break;
+    }
+    write_size += nwrite;
+  }
+
+  BufferPop(write_size);
+  return s;
+}
+
+void StreamSocket::BufferPop(size_t size) {
+  size_t new_size = buffer_.size() - size;
+  memmove(&buffer_[0], &buffer_[size], new_size);
+  buffer_.resize(new_size);
+}
+}  // namespace webkit
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "webkit/packet.h"
+#include "webkit/socket.h"
+#include "webkit/status.h"
+
+namespace webkit {
+// connected stream socket over a file descriptor, the address family is up
+// to the subclass, reads and writes are the same for tcp and unix sockets
+class StreamSocket : public Socket {
+ public:
+  StreamSocket();
+
+  StreamSocket(int fd);
+
+  virtual ~StreamSocket();
+
+  Status Write(const void *src, size_t src_size, size_t &write_size) override;
+
+  Status Write(IoBase &dst, size_t dst_size, size_t &write_size) override;
+
+  Status Read(void *dst, size_t dst_size, size_t &read_size) override;
+
+  Status Read(IoBase &src, size_t src_size, size_t &read_size) override;
+
+  Status Close() override;
+
+  Status SetNonBlock();
+
+  Status SetTimeout(suseconds_t timeout_sec = 2, suseconds_t timeout_us = 0);
+
+  int GetFd() const override;
+
+  bool IsConnected() const;
+
+ protected:
+  Status ReadToBuffer(size_t data_size, size_t &read_size);
+
+  Status WriteFromBuffer(size_t data_size, size_t &write_size);
+
+  // send the head of packet from its own memory or file, without copying it
+  // into buffer_ first, what is sent is consumed from the packet
+  Status WriteFromPacket(Packet &packet, size_t data_size, size_t &write_size);
+
+  // one span of packet memory, eRetry if the socket buffer is full
+  virtual Status WriteSpan(const void *data, size_t data_size,
+                           size_t &write_size);
+
+  void BufferPop(size_t size);
+
+  int fd_;
+  bool is_connected_;
+  // set by SetNonBlock, a non blocking socket is driven by the reactor
+  bool is_nonblock_;
+  std::vector<std::byte> buffer_;
+};
+}  // namespace webkit
@@ -2,28 +2,48 @@
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <linux/errqueue.h>
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
-#include <unistd.h>
 
-#include <memory>
-#include <vector>
+#include <cstring>
 
 #include "util/inet_util.h"
-#include "util/syscall.h"
 #include "webkit/logger.h"
 
 namespace webkit {
-TcpSocket::TcpSocket() : fd_(-1), ip_(""), port_(0), is_connected_(false) {}
-
-TcpSocket::TcpSocket(int fd, const std::string &ip, uint16_t port)
-    : fd_(fd), ip_(ip), port_(port), is_connected_(true) {}
-
-TcpSocket::~TcpSocket() {
-  if (is_connected_) Close();
+static Status SetIntOpt(int fd, int level, int name, int value,
+                        const char *name_str) {
+  int ret = setsockopt(fd, level, name, &value, sizeof(value));
+  if (ret != 0) {
+    WEBKIT_LOGERROR("tcp socket set %s error %d %s", name_str, errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketOptError,
+                         "socket set sock opt error");
+  }
+  return Status::OK();
 }
 
-Status TcpSocket::Connect(const std::string &ip, uint16_t port) {
+TcpSocket::TcpSocket()
+    : ip_(""),
+      port_(0),
+      is_cork_(false),
+      zerocopy_threshold_(0),
+      zerocopy_send_num_(0),
+      zerocopy_done_num_(0) {}
+
+TcpSocket::TcpSocket(int fd, const std::string &ip, uint16_t port)
+    : StreamSocket(fd),
+      ip_(ip),
+      port_(port),
+      is_cork_(false),
+      zerocopy_threshold_(0),
+      zerocopy_send_num_(0),
+      zerocopy_done_num_(0) {}
+
+Status TcpSocket::Connect(const std::string &ip, uint16_t port,
+                          const SocketOption &option) {
   if (is_connected_) {
     WEBKIT_LOGERROR("tcp socket already connected %s:%u", ip, port);
     return Status::Error(StatusCode::eSocketConnected,
@@ -45,6 +65,17 @@ Status TcpSocket::Connect(const std::string &ip, uint16_t port) {
     return s;
   }
 
+  // the window scale is settled by the handshake, so buffers go first
+  s = SetBufferSize(option);
+  if (!s.Ok()) return s;
+#ifdef TCP_FASTOPEN_CONNECT
+  if (option.fastopen_queue_len > 0) {
+    s = SetIntOpt(fd_, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1,
+                  "TCP_FASTOPEN_CONNECT");
+    if (!s.Ok()) return s;
+  }
+#endif
+
   ret = connect(fd_, reinterpret_cast<struct sockaddr *>(&sin), sizeof(sin));
   if (ret < 0) {
     WEBKIT_LOGERROR("tcp socket connect error %d %s", errno, strerror(errno));
@@ -53,10 +84,13 @@ Status TcpSocket::Connect(const std::string &ip, uint16_t port) {
   }
 
   is_connected_ = true;
+  s = SetOption(option);
+  if (!s.Ok()) return s;
   return SetTimeout();
 }
 
-Status TcpSocket::Listen(const std::string &ip, uint16_t port) {
+Status TcpSocket::Listen(const std::string &ip, uint16_t port,
+                         const SocketOption &option) {
   if (is_connected_) {
     WEBKIT_LOGERROR("tcp socket already connected %s:%u", ip, port);
     return Status::Error(StatusCode::eSocketConnected,
@@ -93,7 +127,20 @@ Status TcpSocket::Listen(const std::string &ip, uint16_t port) {
     return Status::Error(StatusCode::eSocketBindError, "socket bind error");
   }
 
-  ret = listen(fd_, 1024);
+  s = SetBufferSize(option);
+  if (!s.Ok()) return s;
+  if (option.defer_accept_sec > 0) {
+    s = SetIntOpt(fd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, option.defer_accept_sec,
+                  "TCP_DEFER_ACCEPT");
+    if (!s.Ok()) return s;
+  }
+  if (option.fastopen_queue_len > 0) {
+    s = SetIntOpt(fd_, IPPROTO_TCP, TCP_FASTOPEN, option.fastopen_queue_len,
+                  "TCP_FASTOPEN");
+    if (!s.Ok()) return s;
+  }
+
+  ret = listen(fd_, option.listen_backlog);
   if (ret < 0) {
     WEBKIT_LOGERROR("tcp socket listen error %d %s", errno, strerror(errno));
     return Status::Error(StatusCode::eSocketListenError, "socket listen error");
@@ -133,259 +180,220 @@ Status TcpSocket::Accept(TcpSocket *socket) {
 }
 
 Status TcpSocket::Close() {
-  if (!is_connected_) {
-    WEBKIT_LOGFATAL("tcp socket disconnected");
-    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
-  }
-  int ret = close(fd_);
-  if (ret != 0) {
-    WEBKIT_LOGERROR("tcp socket close error %d %s", errno, strerror(errno));
-    return Status::Error(StatusCode::eSocketCloseError, "socket close error");
-  }
-  fd_ = -1;
+  Status s = StreamSocket::Close();
+  if (!s.Ok()) return s;
   ip_ = "";
   port_ = 0;
-  is_connected_ = false;
-  buffer_.clear();
+  is_cork_ = false;
+  zerocopy_threshold_ = 0;
+  zerocopy_send_num_ = 0;
+  zerocopy_done_num_ = 0;
   return Status::OK();
 }
 
-Status TcpSocket::Write(const void *data, size_t data_size,
-                        size_t &write_size) {
-  if (!is_connected_) {
-    WEBKIT_LOGERROR("tcp socket disconnected");
-    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
-  }
-  write_size = 0;
-  Status s = WriteFromBuffer(data_size, write_size);
-  if (!s.Ok()) return s;
-  while (write_size < data_size) {
-    ssize_t nwrite = write(fd_, data, data_size);
-    if (nwrite < 0) {
-      if (errno == EINTR) continue;
-      if (errno == EAGAIN) {
-        return Status::Warn(StatusCode::eRetry);
-      }
-      WEBKIT_LOGERROR("tcp socket write error %d %s", errno, strerror(errno));
-      return Status::Error(StatusCode::eSocketWriteError, "socket write error");
-    }
-    if (nwrite == 0) {  // no log error if peer closed
-      return Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
-    }
-    write_size += nwrite;
+Status TcpSocket::Attach(int fd) {
+  if (is_connected_) {
+    WEBKIT_LOGERROR("tcp socket already connected fd %d", fd_);
+    return Status::Error(StatusCode::eSocketConnected,
+                         "socket already connected");
   }
-  return Status::OK();
-}
 
-Status TcpSocket::Write(IoBase &src, size_t src_size, size_t &write_size) {
-  if (!is_connected_) {
-    WEBKIT_LOGERROR("tcp socket disconnected");
-    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  socklen_t sin_len = sizeof(sin);
+  int ret =
+      getsockname(fd, reinterpret_cast<struct sockaddr *>(&sin), &sin_len);
+  if (ret < 0 || sin.sin_family != AF_INET) {
+    WEBKIT_LOGERROR("tcp socket attach fd %d error %d %s", fd, errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketOptError, "socket attach error");
   }
-  write_size = 0;
 
-  if (buffer_.size() < src_size) {
-    size_t write_pos = buffer_.size();
-    buffer_.resize(src_size);
-    size_t read_size = 0;
-    Status s = src.Read(&buffer_[write_pos], src_size - write_pos, read_size);
-    if (!s.Ok() || write_pos + read_size != src_size) {
-      WEBKIT_LOGERROR("read src expect %zu get %zu status code %d message %s",
-                      src_size - write_pos, read_size, s.Code(), s.Message());
-      return s;
-    }
+  Status s = InetUtil::InetNtop(sin.sin_addr, ip_);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("trans ip addr error %d %s", errno, strerror(errno));
+    return s;
   }
-
-  Status s = WriteFromBuffer(src_size, write_size);
-  if (!s.Ok()) return s;
-
+  fd_ = fd;
+  port_ = InetUtil::Ntoh(sin.sin_port);
+  is_connected_ = true;
   return Status::OK();
 }
 
-Status TcpSocket::Read(void *dst, size_t dst_size, size_t &read_size) {
+Status TcpSocket::SetLinger(bool is_on, int linger_sec) {
   if (!is_connected_) {
     WEBKIT_LOGERROR("tcp socket disconnected");
     return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
   }
-  read_size = 0;
-  if (buffer_.size() != 0) {
-    size_t data_size = std::min(buffer_.size(), dst_size);
-    memcpy(dst, &buffer_[0], data_size);
-    BufferPop(data_size);
-    read_size = data_size;
-  }
-
-  while (read_size < dst_size) {
-    ssize_t nread = read(fd_, reinterpret_cast<uint8_t *>(dst) + read_size,
-                         dst_size - read_size);
-    if (nread < 0) {
-      if (errno == EINTR) continue;
-      if (errno == EAGAIN) {
-        return Status::Warn(StatusCode::eNoData);
-      }
-      WEBKIT_LOGERROR("tcp socket read error %d %s", errno, strerror(errno));
-      return Status::Error(StatusCode::eSocketReadError, "socket read error");
-    }
-    if (nread == 0) {  // no log error if peer closed
-      return Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
-    }
-    read_size += nread;
+  struct linger linger_opt;
+  linger_opt.l_onoff = is_on;
+  linger_opt.l_linger = linger_sec;
+  int ret =
+      setsockopt(fd_, SOL_SOCKET, SO_LINGER, &linger_opt, sizeof(linger_opt));
+  if (ret != 0) {
+    WEBKIT_LOGERROR("tcp socket set sock opt error %d %s", errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketOptError,
+                         "socket set sock opt error");
   }
-
   return Status::OK();
 }
 
-Status TcpSocket::Read(IoBase &dst, size_t dst_size, size_t &read_size) {
+Status TcpSocket::SetBusyPoll(int busy_poll_us) {
   if (!is_connected_) {
     WEBKIT_LOGERROR("tcp socket disconnected");
     return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
   }
-  read_size = 0;
-
-  if (buffer_.size() < dst_size) {
-    size_t data_size = dst_size - buffer_.size();
-    size_t write_size = 0;
-    Status s = ReadToBuffer(data_size, write_size);
-    if (!s.Ok()) return s;
+  int ret = setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us,
+                       sizeof(busy_poll_us));
+#ifdef SO_PREFER_BUSY_POLL
+  if (ret == 0) {
+    int is_prefer = busy_poll_us > 0;
+    ret = setsockopt(fd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &is_prefer,
+                     sizeof(is_prefer));
   }
-
-  Status s = dst.Write(&buffer_[0], dst_size, read_size);
-  BufferPop(read_size);
-  if (!s.Ok() || dst_size != read_size) {
-    WEBKIT_LOGERROR("write dst expect %zu get %zu status code %d message %s",
-                    dst_size, read_size, s.Code(), s.Message());
-    return s;
+#endif
+  if (ret != 0) {
+    WEBKIT_LOGERROR("tcp socket set sock opt error %d %s", errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketOptError,
+                         "socket set sock opt error");
   }
-
   return Status::OK();
 }
 
-Status TcpSocket::SetNonBlock() {
+Status TcpSocket::SetOption(const SocketOption &option) {
   if (!is_connected_) {
     WEBKIT_LOGERROR("tcp socket disconnected");
     return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
   }
-  Status s = Syscall::SetNonBlock(fd_);
-  if (!s.Ok()) {
-    WEBKIT_LOGERROR("set non block error status code %d message %s", s.Code(),
-                    s.Message());
-    return s;
+  Status s;
+  if (option.is_nodelay) {
+    s = SetIntOpt(fd_, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    if (!s.Ok()) return s;
   }
-  return Status::OK();
-}
-
-Status TcpSocket::SetTimeout(suseconds_t timeout_sec, suseconds_t timeout_us) {
-  if (!is_connected_) {
-    WEBKIT_LOGERROR("tcp socket disconnected");
-    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  if (option.is_quickack) {
+    s = SetIntOpt(fd_, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+    if (!s.Ok()) return s;
   }
-
-  int ret = 0;
-  struct timeval timeout;
-  timeout.tv_sec = timeout_sec;
-  timeout.tv_usec = timeout_us;
-
-  ret = setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-  if (ret != 0) {
-    WEBKIT_LOGERROR("tcp socket set recv timeout error %d %s", errno,
-                    strerror(errno));
-    return Status::Error(StatusCode::eSocketOptError,
-                         "socket set sock opt error");
+  if (option.user_timeout_ms > 0) {
+    s = SetIntOpt(fd_, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                  static_cast<int>(option.user_timeout_ms), "TCP_USER_TIMEOUT");
+    if (!s.Ok()) return s;
   }
-
-  ret = setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
-  if (ret != 0) {
-    WEBKIT_LOGERROR("tcp socket set send timeout error %d %s", errno,
-                    strerror(errno));
-    return Status::Error(StatusCode::eSocketOptError,
-                         "socket set sock ope error");
+  if (option.is_keepalive) {
+    s = SetIntOpt(fd_, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+    if (s.Ok() && option.keepalive_idle_sec > 0) {
+      s = SetIntOpt(fd_, IPPROTO_TCP, TCP_KEEPIDLE, option.keepalive_idle_sec,
+                    "TCP_KEEPIDLE");
+    }
+    if (s.Ok() && option.keepalive_interval_sec > 0) {
+      s = SetIntOpt(fd_, IPPROTO_TCP, TCP_KEEPINTVL,
+                    option.keepalive_interval_sec, "TCP_KEEPINTVL");
+    }
+    if (s.Ok() && option.keepalive_count > 0) {
+      s = SetIntOpt(fd_, IPPROTO_TCP, TCP_KEEPCNT, option.keepalive_count,
+                    "TCP_KEEPCNT");
+    }
+    if (!s.Ok()) return s;
   }
-
+  is_cork_ = option.is_cork;
   return Status::OK();
 }
 
-Status TcpSocket::SetLinger(bool is_on, int linger_sec) {
+void TcpSocket::Cork(bool is_on) {
+  if (!is_cork_ || !is_connected_) return;
+  // uncorking flushes what is held back, a failure only costs latency
+  SetIntOpt(fd_, IPPROTO_TCP, TCP_CORK, is_on, "TCP_CORK");
+}
+
+Status TcpSocket::SetZeroCopy(size_t threshold) {
   if (!is_connected_) {
     WEBKIT_LOGERROR("tcp socket disconnected");
     return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
   }
-  struct linger linger_opt;
-  linger_opt.l_onoff = is_on;
-  linger_opt.l_linger = linger_sec;
-  int ret =
-      setsockopt(fd_, SOL_SOCKET, SO_LINGER, &linger_opt, sizeof(linger_opt));
-  if (ret != 0) {
-    WEBKIT_LOGERROR("tcp socket set sock opt error %d %s", errno,
-                    strerror(errno));
-    return Status::Error(StatusCode::eSocketOptError,
-                         "socket set sock opt error");
+  if (threshold > 0) {
+    Status s = SetIntOpt(fd_, SOL_SOCKET, SO_ZEROCOPY, 1, "SO_ZEROCOPY");
+    if (!s.Ok()) return s;
   }
+  zerocopy_threshold_ = threshold;
   return Status::OK();
 }
 
-int TcpSocket::GetFd() const { return fd_; }
-
-bool TcpSocket::IsConnected() const { return is_connected_; }
-
-const std::string &TcpSocket::GetIp() const { return ip_; }
-
-uint16_t TcpSocket::GetPort() const { return port_; }
-
-Status TcpSocket::ReadToBuffer(size_t data_size, size_t &read_size) {
-  size_t write_pos = buffer_.size();
-  buffer_.resize(write_pos + data_size);
-
-  read_size = 0;
-  while (read_size < data_size) {
-    ssize_t nread = read(fd_, &buffer_[write_pos], data_size - read_size);
-    if (nread < 0) {
+Status TcpSocket::ReapSend() {
+  while (zerocopy_done_num_ != zerocopy_send_num_) {
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    int ret = recvmsg(fd_, &msg, MSG_ERRQUEUE);
+    if (ret < 0) {
       if (errno == EINTR) continue;
       if (errno == EAGAIN) {
-        return Status::Warn(StatusCode::eNoData);
+        return Status::Debug(StatusCode::eRetry, "zero copy send pending");
       }
-      WEBKIT_LOGERROR("tcp socket read error %d %s", errno, strerror(errno));
-      return Status::Error(StatusCode::eSocketReadError, "socket read error");
+      WEBKIT_LOGERROR("tcp socket reap error %d %s", errno, strerror(errno));
+      return Status::Error(StatusCode::eSocketReadError, "socket reap error");
     }
-    if (nread == 0) {
-      return Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR) {
+        continue;
+      }
+      auto *err = reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(cmsg));
+      if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      // completions of the sends numbered ee_info to ee_data
+      zerocopy_done_num_ += err->ee_data - err->ee_info + 1;
+      // the kernel had to copy after all, e.g. over loopback, pinning
+      // pages and reaping only adds to that, so stop
+      if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) zerocopy_threshold_ = 0;
     }
-    read_size += nread;
   }
-
   return Status::OK();
 }
 
-Status TcpSocket::WriteFromBuffer(size_t data_size, size_t &write_size) {
-  size_t read_size = std::min(buffer_.size(), data_size);
-
+Status TcpSocket::WriteSpan(const void *data, size_t data_size,
+                            size_t &write_size) {
+  if (zerocopy_threshold_ == 0 || data_size < zerocopy_threshold_) {
+    return StreamSocket::WriteSpan(data, data_size, write_size);
+  }
   write_size = 0;
-  Status s = Status::OK();
-  while (write_size < read_size) {
-    ssize_t nwrite = write(fd_, &buffer_[write_size], read_size - write_size);
-    if (nwrite < 0) {
-      if (errno == EINTR) continue;
-      if (errno == EAGAIN) {
-        s = Status::Warn(StatusCode::eRetry);
-        break;
-      }
-      WEBKIT_LOGERROR("tcp socket write error %d %s", errno, strerror(errno));
-      s = Status::Error(StatusCode::eSocketWriteError, "socket write error");
-      break;
-    }
-    if (nwrite == 0) {
-      s = Status::Error(StatusCode::eSocketPeerClosed, "socket peer closed");
-      break;
+  ssize_t nwrite = send(fd_, data, data_size, MSG_ZEROCOPY);
+  if (nwrite < 0) {
+    if (errno == EINTR) return Status::OK();
+    if (errno == EAGAIN) return Status::Warn(StatusCode::eRetry);
+    // out of option memory or locked pages, this span is copied instead
+    if (errno == ENOBUFS) {
+      return StreamSocket::WriteSpan(data, data_size, write_size);
     }
-    write_size += nwrite;
+    WEBKIT_LOGERROR("tcp socket zero copy send error %d %s", errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketWriteError, "socket write error");
   }
-
-  BufferPop(write_size);
-  return s;
+  zerocopy_send_num_++;
+  write_size = nwrite;
+  return Status::OK();
 }
 
-void TcpSocket::BufferPop(size_t size) {
-  size_t new_size = buffer_.size() - size;
-  memmove(&buffer_[0], &buffer_[size], new_size);
-  buffer_.resize(new_size);
+Status TcpSocket::SetBufferSize(const SocketOption &option) {
+  Status s;
+  if (option.send_buffer_size > 0) {
+    s = SetIntOpt(fd_, SOL_SOCKET, SO_SNDBUF, option.send_buffer_size,
+                  "SO_SNDBUF");
+    if (!s.Ok()) return s;
+  }
+  if (option.recv_buffer_size > 0) {
+    s = SetIntOpt(fd_, SOL_SOCKET, SO_RCVBUF, option.recv_buffer_size,
+                  "SO_RCVBUF");
+    if (!s.Ok()) return s;
+  }
+  return Status::OK();
 }
+
+const std::string &TcpSocket::GetIp() const { return ip_; }
+
+uint16_t TcpSocket::GetPort() const { return port_; }
 }  // namespace webkit
@@ -1,60 +1,73 @@
 #pragma once
 
-#include <vector>
+#include <string>
 
-#include "webkit/socket.h"
-#include "webkit/status.h"
+#include "socket/stream_socket.h"
+#include "webkit/socket_option.h"
 
 namespace webkit {
-class TcpSocket : public Socket {
+class TcpSocket : public StreamSocket {
  public:
   TcpSocket();
 
   TcpSocket(int fd, const std::string &ip, uint16_t port);
 
-  ~TcpSocket();
+  ~TcpSocket() = default;
 
-  Status Connect(const std::string &ip, uint16_t port);
+  Status Connect(const std::string &ip, uint16_t port,
+                 const SocketOption &option = SocketOption());
 
-  Status Listen(const std::string &ip, uint16_t port);
+  // sockets accepted from it inherit the buffer sizes, the other
+  // per connection options are applied with SetOption
+  Status Listen(const std::string &ip, uint16_t port,
+                const SocketOption &option = SocketOption());
 
   Status Accept(TcpSocket *socket);
 
-  Status Write(const void *src, size_t src_size, size_t &write_size) override;
-
-  Status Write(IoBase &dst, size_t dst_size, size_t &write_size) override;
-
-  Status Read(void *dst, size_t dst_size, size_t &read_size) override;
-
-  Status Read(IoBase &src, size_t src_size, size_t &read_size) override;
+  // take over fd, a socket already listening or connected, e.g. one passed
+  // from another process
+  Status Attach(int fd);
 
   Status Close() override;
 
-  Status SetNonBlock();
+  Status SetLinger(bool is_on, int linger_time);
 
-  Status SetTimeout(suseconds_t timeout_sec = 2, suseconds_t timeout_us = 0);
+  // SO_BUSY_POLL, and SO_PREFER_BUSY_POLL where the kernel headers have it
+  Status SetBusyPoll(int busy_poll_us);
 
-  Status SetLinger(bool is_on, int linger_time);
+  // per connection part of option, nodelay, quickack, cork, user timeout
+  // and keepalive
+  Status SetOption(const SocketOption &option);
 
-  int GetFd() const override;
+  // TCP_CORK if the option asked for it
+  void Cork(bool is_on) override;
 
-  bool IsConnected() const;
+  // SO_ZEROCOPY, packet spans of at least threshold bytes are then sent
+  // with MSG_ZEROCOPY, the kernel sends from the packet memory directly so
+  // the packet must be kept until ReapSend returns OK, 0 disables it
+  Status SetZeroCopy(size_t threshold);
+
+  // drain zero copy completions from the socket error queue
+  Status ReapSend() override;
 
   const std::string &GetIp() const;
 
   uint16_t GetPort() const;
 
- private:
-  Status ReadToBuffer(size_t data_size, size_t &read_size);
-
-  Status WriteFromBuffer(size_t data_size, size_t &write_size);
+ protected:
+  Status WriteSpan(const void *data, size_t data_size,
+                   size_t &write_size) override;
 
-  void BufferPop(size_t size);
+ private:
+  Status SetBufferSize(const SocketOption &option);
 
-  int fd_;
   std::string ip_;
   uint16_t port_;
-  bool is_connected_;
-  std::vector<std::byte> buffer_;
+  bool is_cork_;
+  size_t zerocopy_threshold_;
+  // zero copy sends issued and completed, ids wrap at 32 bits like the
+  // kernel's
+  uint32_t zerocopy_send_num_;
+  uint32_t zerocopy_done_num_;
 };
 }  // namespace webkit
\ No newline at end of file
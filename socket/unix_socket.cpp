@@ -0,0 +1,171 @@
+#include "unix_socket.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "util/inet_util.h"
+#include "webkit/logger.h"
+
+namespace webkit {
+UnixSocket::UnixSocket() : path_("") {}
+
+Status UnixSocket::Connect(const std::string &path) {
+  if (is_connected_) {
+    WEBKIT_LOGERROR("unix socket already connected %s", path);
+    return Status::Error(StatusCode::eSocketConnected,
+                         "socket already connected");
+  }
+
+  struct sockaddr_un sun;
+  Status s = InetUtil::MakeUnixAddr(path, &sun);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("make unix addr error status code %d message %s",
+                    s.Code(), s.Message());
+    return s;
+  }
+
+  fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    WEBKIT_LOGERROR("unix socket create error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketCreateError, "socket create error");
+  }
+
+  int ret =
+      connect(fd_, reinterpret_cast<struct sockaddr *>(&sun), sizeof(sun));
+  if (ret < 0) {
+    WEBKIT_LOGERROR("unix socket connect %s error %d %s", path, errno,
+                    strerror(errno));
+    close(fd_);
+    fd_ = -1;
+    return Status::Error(StatusCode::eSocketConnectError,
+                         "socket connect error");
+  }
+
+  is_connected_ = true;
+  return SetTimeout();
+}
+
+Status UnixSocket::Listen(const std::string &path) {
+  if (is_connected_) {
+    WEBKIT_LOGERROR("unix socket already connected %s", path);
+    return Status::Error(StatusCode::eSocketConnected,
+                         "socket already connected");
+  }
+
+  struct sockaddr_un sun;
+  Status s = InetUtil::MakeUnixAddr(path, &sun);
+  if (!s.Ok()) {
+    WEBKIT_LOGERROR("make unix addr error status code %d message %s",
+                    s.Code(), s.Message());
+    return s;
+  }
+
+  // a path some process still accepts on is taken, one nobody accepts on is
+  // a leftover and is replaced
+  int probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (probe_fd >= 0) {
+    int ret = connect(probe_fd, reinterpret_cast<struct sockaddr *>(&sun),
+                      sizeof(sun));
+    close(probe_fd);
+    if (ret == 0) {
+      WEBKIT_LOGERROR("unix socket path %s in use", path);
+      return Status::Error(StatusCode::eSocketBindError, "socket bind error");
+    }
+  }
+  unlink(path.c_str());
+
+  fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    WEBKIT_LOGERROR("unix socket create error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketCreateError, "socket create error");
+  }
+
+  int ret = bind(fd_, reinterpret_cast<struct sockaddr *>(&sun), sizeof(sun));
+  if (ret < 0) {
+    WEBKIT_LOGERROR("unix socket bind %s error %d %s", path, errno,
+                    strerror(errno));
+    close(fd_);
+    fd_ = -1;
+    return Status::Error(StatusCode::eSocketBindError, "socket bind error");
+  }
+
+  // only processes of the same user may connect, like the handoff path
+  ret = chmod(path.c_str(), S_IRUSR | S_IWUSR);
+  if (ret == 0) ret = listen(fd_, 1024);
+  if (ret < 0) {
+    WEBKIT_LOGERROR("unix socket listen error %d %s", errno, strerror(errno));
+    close(fd_);
+    fd_ = -1;
+    return Status::Error(StatusCode::eSocketListenError, "socket listen error");
+  }
+
+  path_ = path;
+  is_connected_ = true;
+  return SetTimeout();
+}
+
+Status UnixSocket::Accept(UnixSocket *socket) {
+  if (!is_connected_) {
+    WEBKIT_LOGERROR("unix socket disconnected");
+    return Status::Error(StatusCode::eSocketDisonnected, "socket disconnected");
+  }
+
+  socket->fd_ = accept(fd_, nullptr, nullptr);
+  if (socket->fd_ < 0) {
+    if (errno == EINTR || errno == EAGAIN) {
+      return Status::Warn(StatusCode::eRetry);
+    }
+    WEBKIT_LOGERROR("unix socket accept error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eSocketAcceptError, "socket accept error");
+  }
+  socket->is_connected_ = true;
+  return Status::OK();
+}
+
+Status UnixSocket::Attach(int fd) {
+  if (is_connected_) {
+    WEBKIT_LOGERROR("unix socket already connected fd %d", fd_);
+    return Status::Error(StatusCode::eSocketConnected,
+                         "socket already connected");
+  }
+
+  struct sockaddr_un sun;
+  memset(&sun, 0, sizeof(sun));
+  socklen_t sun_len = sizeof(sun);
+  int ret =
+      getsockname(fd, reinterpret_cast<struct sockaddr *>(&sun), &sun_len);
+  if (ret < 0 || sun.sun_family != AF_UNIX) {
+    WEBKIT_LOGERROR("unix socket attach fd %d error %d %s", fd, errno,
+                    strerror(errno));
+    return Status::Error(StatusCode::eSocketOptError, "socket attach error");
+  }
+
+  fd_ = fd;
+  path_ = sun.sun_path;
+  is_connected_ = true;
+  return Status::OK();
+}
+
+std::string UnixSocket::GetSockPath(int fd) {
+  struct sockaddr_un sun;
+  memset(&sun, 0, sizeof(sun));
+  socklen_t sun_len = sizeof(sun);
+  int ret =
+      getsockname(fd, reinterpret_cast<struct sockaddr *>(&sun), &sun_len);
+  if (ret < 0 || sun.sun_family != AF_UNIX) return "";
+  return sun.sun_path;
+}
+
+Status UnixSocket::Close() {
+  Status s = StreamSocket::Close();
+  if (!s.Ok()) return s;
+  path_ = "";
+  return Status::OK();
+}
+
+const std::string &UnixSocket::GetPath() const { return path_; }
+}  // namespace webkit
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include "socket/stream_socket.h"
+
+namespace webkit {
+// AF_UNIX stream socket, for peers on the same host it skips the tcp/ip
+// stack, no checksums, no acks and no loopback device in between
+class UnixSocket : public StreamSocket {
+ public:
+  UnixSocket();
+
+  ~UnixSocket() = default;
+
+  Status Connect(const std::string &path);
+
+  // a socket file left behind at path by a dead process is replaced, the
+  // new one is only accessible to the owner
+  Status Listen(const std::string &path);
+
+  Status Accept(UnixSocket *socket);
+
+  // take over fd, a unix socket already listening or connected
+  Status Attach(int fd);
+
+  Status Close() override;
+
+  // the bound path, empty for an accepted socket
+  const std::string &GetPath() const;
+
+  // the path fd is bound to, empty if it is not a bound unix socket
+  static std::string GetSockPath(int fd);
+
+ private:
+  std::string path_;
+};
+}  // namespace webkit
@@ -0,0 +1,331 @@
+#include "load_generator.h"
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "channel/simple_adapter.h"
+#include "dispatcher/string_serialization.h"
+#include "packet/byte_packet.h"
+#include "util/inet_util.h"
+#include "util/tsc_clock.h"
+
+// SimpleAdapter frame header, u32 version and u32 body length
+static constexpr size_t kFrameHeaderSize = 2 * sizeof(uint32_t);
+static constexpr size_t kStatusCodeOffset =
+    kFrameHeaderSize +
+    offsetof(webkit::StringSerialization::MetaInfo, status_code);
+static constexpr size_t kRecvChunkSize = 64 * 1024;
+static constexpr size_t kMaxPacketSize = 64UL << 20;
+
+static uint64_t NowNs() { return webkit::TscClock::MonotonicNs(); }
+
+LoadWorker::LoadWorker(const LoadOption &option, uint32_t worker_idx,
+                       uint32_t connection_num)
+    : option_(option),
+      conn_vec_(connection_num),
+      rng_(worker_idx * 7919 + NowNs()),
+      interval_ns_(0) {
+  if (option_.rate > 0) {
+    interval_ns_ = static_cast<uint64_t>(1e9 * option_.connection_num /
+                                         option_.rate);
+  }
+}
+
+void LoadWorker::Run(uint64_t begin_ns, uint64_t warmup_end_ns,
+                     uint64_t end_ns) {
+  std::vector<struct pollfd> pollfd_vec(conn_vec_.size());
+  for (size_t i = 0; i < conn_vec_.size(); i++) {
+    // spread the first intended sends over one interval
+    conn_vec_[i].next_send_ns =
+        begin_ns + interval_ns_ * i / std::max<size_t>(conn_vec_.size(), 1);
+  }
+
+  uint64_t timeout_ns = option_.timeout_ms * 1000000UL;
+  uint64_t now_ns = NowNs();
+  bool is_failed = false;
+  while (now_ns < end_ns && !is_failed) {
+    bool is_measured = now_ns >= warmup_end_ns;
+    uint64_t wake_ns = now_ns + 1000000;
+    for (size_t i = 0; i < conn_vec_.size(); i++) {
+      LoadConnection &conn = conn_vec_[i];
+      if (conn.socket_up == nullptr && !Connect(conn, now_ns)) {
+        pollfd_vec[i].fd = -1;
+        continue;
+      }
+      if (conn.is_connecting) {
+        if (now_ns - conn.connect_ns > timeout_ns) {
+          Close(conn, is_measured);
+          pollfd_vec[i].fd = -1;
+          continue;
+        }
+        pollfd_vec[i].fd = conn.socket_up->GetFd();
+        pollfd_vec[i].events = POLLOUT;
+        pollfd_vec[i].revents = 0;
+        continue;
+      }
+      if (!conn.inflight_queue.empty() &&
+          now_ns - conn.inflight_queue.front().send_ns > timeout_ns) {
+        Close(conn, is_measured);
+        pollfd_vec[i].fd = -1;
+        continue;
+      }
+      if (!Fill(conn, now_ns)) {
+        is_failed = true;
+        break;
+      }
+      if (interval_ns_ > 0 && conn.inflight_queue.size() < option_.depth) {
+        wake_ns = std::min(wake_ns, conn.next_send_ns);
+      }
+      pollfd_vec[i].fd = conn.socket_up->GetFd();
+      pollfd_vec[i].events = POLLIN;
+      if (conn.send_pos < conn.send_buf.size()) pollfd_vec[i].events |= POLLOUT;
+      pollfd_vec[i].revents = 0;
+    }
+    if (is_failed) break;
+
+    int timeout_ms = wake_ns > now_ns ? (wake_ns - now_ns) / 1000000 : 0;
+    int nevent = poll(pollfd_vec.data(), pollfd_vec.size(), timeout_ms);
+    now_ns = NowNs();
+    if (nevent <= 0) continue;
+    is_measured = now_ns >= warmup_end_ns;
+    for (size_t i = 0; i < conn_vec_.size(); i++) {
+      LoadConnection &conn = conn_vec_[i];
+      short revents = pollfd_vec[i].revents;
+      if (pollfd_vec[i].fd < 0 || revents == 0) continue;
+      if (conn.is_connecting) {
+        if (!FinishConnect(conn)) Close(conn, is_measured);
+        continue;
+      }
+      if ((revents & POLLOUT) && !Send(conn, is_measured)) {
+        Close(conn, is_measured);
+        continue;
+      }
+      if (!(revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      // the server answers one request per connection, so the connection
+      // is done once nothing is in flight
+      if (!Recv(conn, now_ns, is_measured) || conn.inflight_queue.empty()) {
+        Close(conn, is_measured);
+      }
+    }
+  }
+
+  for (LoadConnection &conn : conn_vec_) {
+    if (conn.socket_up != nullptr) Close(conn, false);
+  }
+}
+
+bool LoadWorker::Connect(LoadConnection &conn, uint64_t now_ns) {
+  struct sockaddr_in sin;
+  webkit::Status s = webkit::InetUtil::MakeSockAddr(option_.ip, option_.port,
+                                                    &sin);
+  if (!s.Ok()) return false;
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) return false;
+  auto socket_up =
+      std::make_unique<webkit::TcpSocket>(fd, option_.ip, option_.port);
+  s = socket_up->SetNonBlock();
+  if (!s.Ok()) return false;
+  // the connect completes in the poll loop, other connections keep going
+  int ret = connect(fd, reinterpret_cast<struct sockaddr *>(&sin), sizeof(sin));
+  if (ret < 0 && errno != EINPROGRESS) return false;
+  conn.socket_up = std::move(socket_up);
+  conn.is_connecting = ret < 0;
+  conn.connect_ns = now_ns;
+  conn.send_buf.clear();
+  conn.send_pos = 0;
+  conn.recv_buf.clear();
+  // intended sends missed while disconnected are still owed in open loop
+  // mode, they are sent late and their latency counts from the schedule
+  if (interval_ns_ == 0) conn.next_send_ns = now_ns;
+  return true;
+}
+
+bool LoadWorker::FinishConnect(LoadConnection &conn) {
+  int error = 0;
+  socklen_t len = sizeof(error);
+  int ret = getsockopt(conn.socket_up->GetFd(), SOL_SOCKET, SO_ERROR, &error,
+                       &len);
+  if (ret < 0 || error != 0) return false;
+  conn.is_connecting = false;
+  return true;
+}
+
+// closing a connection after its reply is the normal case, only a close
+// with requests still in flight counts them as errors and as a reconnect
+void LoadWorker::Close(LoadConnection &conn, bool is_measured) {
+  if (is_measured && !conn.inflight_queue.empty()) {
+    report_.error_num += conn.inflight_queue.size();
+    report_.reconnect_num++;
+  }
+  conn.inflight_queue.clear();
+  conn.is_connecting = false;
+  conn.socket_up->Close();
+  conn.socket_up.reset();
+}
+
+bool LoadWorker::Fill(LoadConnection &conn, uint64_t now_ns) {
+  while (conn.inflight_queue.size() < option_.depth) {
+    const std::string *frame = GetFrame(NextPayloadSize());
+    if (frame == nullptr) return false;
+    uint64_t intended_ns = now_ns;
+    if (interval_ns_ > 0) {
+      if (conn.next_send_ns > now_ns) break;
+      intended_ns = conn.next_send_ns;
+      conn.next_send_ns += interval_ns_;
+    }
+    if (conn.send_pos == conn.send_buf.size()) {
+      conn.send_buf.clear();
+      conn.send_pos = 0;
+    }
+    conn.send_buf += *frame;
+    conn.inflight_queue.push_back(LoadRequest{intended_ns, now_ns});
+  }
+  return true;
+}
+
+bool LoadWorker::Send(LoadConnection &conn, bool is_measured) {
+  while (conn.send_pos < conn.send_buf.size()) {
+    ssize_t ret = send(conn.socket_up->GetFd(), &conn.send_buf[conn.send_pos],
+                       conn.send_buf.size() - conn.send_pos, MSG_NOSIGNAL);
+    if (ret < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+    conn.send_pos += ret;
+    if (is_measured) report_.send_bytes += ret;
+  }
+  return true;
+}
+
+bool LoadWorker::Recv(LoadConnection &conn, uint64_t now_ns,
+                      bool is_measured) {
+  char buf[kRecvChunkSize];
+  bool is_open = true;
+  while (true) {
+    ssize_t ret = recv(conn.socket_up->GetFd(), buf, sizeof(buf), 0);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (ret <= 0) {
+      is_open = false;
+      break;
+    }
+    conn.recv_buf.append(buf, ret);
+    if (is_measured) report_.recv_bytes += ret;
+  }
+
+  size_t pos = 0;
+  while (conn.recv_buf.size() - pos >= kFrameHeaderSize) {
+    uint32_t length = 0;
+    memcpy(&length, &conn.recv_buf[pos + sizeof(uint32_t)], sizeof(length));
+    size_t frame_size = kFrameHeaderSize + webkit::InetUtil::Ntoh(length);
+    if (conn.recv_buf.size() - pos < frame_size) break;
+    int32_t status_code = 0;
+    if (frame_size >= kStatusCodeOffset + sizeof(status_code)) {
+      memcpy(&status_code, &conn.recv_buf[pos + kStatusCodeOffset],
+             sizeof(status_code));
+      status_code = webkit::InetUtil::Ntoh(status_code);
+    }
+    pos += frame_size;
+    if (conn.inflight_queue.empty()) return false;
+    uint64_t intended_ns = conn.inflight_queue.front().intended_ns;
+    conn.inflight_queue.pop_front();
+    if (!is_measured) continue;
+    if (status_code != webkit::StatusCode::eOk) {
+      report_.reject_num++;
+      continue;
+    }
+    report_.request_num++;
+    latency_.Record(now_ns > intended_ns ? now_ns - intended_ns : 0);
+  }
+  conn.recv_buf.erase(0, pos);
+  return is_open || conn.inflight_queue.empty();
+}
+
+size_t LoadWorker::NextPayloadSize() {
+  size_t size = option_.payload_size;
+  if (option_.payload_dist == LoadOption::eUniform) {
+    std::uniform_int_distribution<size_t> dist(option_.payload_min_size,
+                                               option_.payload_max_size);
+    size = dist(rng_);
+  } else if (option_.payload_dist == LoadOption::eExp) {
+    std::exponential_distribution<double> dist(1.0 / option_.payload_size);
+    size = static_cast<size_t>(dist(rng_));
+    size = std::clamp(size, option_.payload_min_size, option_.payload_max_size);
+  }
+  return size;
+}
+
+// the body is a json object so the json server example can parse it
+const std::string *LoadWorker::GetFrame(size_t payload_size) {
+  auto iter = frame_map_.find(payload_size);
+  if (iter != frame_map_.end()) return &iter->second;
+
+  static const std::string kBodyHead = "{\"data\":\"";
+  static const std::string kBodyTail = "\"}";
+  std::string body = kBodyHead;
+  size_t pad_size = payload_size > kBodyHead.size() + kBodyTail.size()
+                        ? payload_size - kBodyHead.size() - kBodyTail.size()
+                        : 0;
+  body.append(pad_size, 'x');
+  body += kBodyTail;
+
+  webkit::BytePacket packet(kMaxPacketSize);
+  webkit::BytePacket wire(kMaxPacketSize);
+  webkit::StringSerializer serializer(option_.method_id, body);
+  webkit::Status s = serializer.SerializeTo(packet);
+  if (s.Ok()) {
+    s = webkit::SimpleAdapter(packet, wire, packet.GetDataSize()).AdaptTo();
+  }
+  std::string frame(wire.GetDataSize(), '\0');
+  size_t read_size = 0;
+  if (s.Ok()) s = wire.Read(&frame[0], frame.size(), read_size);
+  if (!s.Ok()) {
+    fprintf(stderr, "frame payload size %zu error status code %d message %s\n",
+            payload_size, s.Code(), s.Message().c_str());
+    return nullptr;
+  }
+  return &frame_map_.emplace(payload_size, std::move(frame)).first->second;
+}
+
+LoadGenerator::LoadGenerator(const LoadOption &option) : option_(option) {}
+
+LoadReport LoadGenerator::Run() {
+  uint32_t thread_num =
+      std::max(1U, std::min(option_.thread_num, option_.connection_num));
+  std::vector<std::unique_ptr<LoadWorker>> worker_vec;
+  for (uint32_t i = 0; i < thread_num; i++) {
+    uint32_t connection_num = option_.connection_num / thread_num +
+                              (i < option_.connection_num % thread_num);
+    worker_vec.push_back(
+        std::make_unique<LoadWorker>(option_, i, connection_num));
+  }
+
+  uint64_t begin_ns = NowNs();
+  uint64_t warmup_end_ns = begin_ns + option_.warmup_sec * 1000000000UL;
+  uint64_t end_ns = warmup_end_ns + option_.duration_sec * 1000000000UL;
+  std::vector<std::thread> thread_vec;
+  for (auto &worker_up : worker_vec) {
+    LoadWorker *worker = worker_up.get();
+    thread_vec.emplace_back(
+        [=] { worker->Run(begin_ns, warmup_end_ns, end_ns); });
+  }
+  for (std::thread &t : thread_vec) t.join();
+
+  LoadReport report;
+  report.elapsed_ns = NowNs() - warmup_end_ns;
+  for (auto &worker_up : worker_vec) {
+    const LoadReport &worker_report = worker_up->GetReport();
+    report.request_num += worker_report.request_num;
+    report.error_num += worker_report.error_num;
+    report.reject_num += worker_report.reject_num;
+    report.reconnect_num += worker_report.reconnect_num;
+    report.send_bytes += worker_report.send_bytes;
+    report.recv_bytes += worker_report.recv_bytes;
+    report.latency.Merge(worker_up->GetLatency());
+  }
+  return report;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "metrics/metrics.h"
+#include "socket/tcp_socket.h"
+
+struct LoadOption {
+  enum PayloadDist {
+    eFixed = 0,
+    eUniform = 1,
+    eExp = 2,
+  };
+
+  LoadOption()
+      : ip("127.0.0.1"),
+        port(8080),
+        thread_num(1),
+        connection_num(1),
+        depth(1),
+        method_id(1),
+        payload_dist(eFixed),
+        payload_size(64),
+        payload_min_size(16),
+        payload_max_size(4096),
+        rate(0),
+        duration_sec(10),
+        warmup_sec(1),
+        timeout_ms(1000) {}
+
+  std::string ip;
+  uint16_t port;
+  uint32_t thread_num;
+  uint32_t connection_num;
+  // requests in flight per connection, main only accepts 1 since the
+  // server closes a connection after its reply
+  uint32_t depth;
+  uint32_t method_id;
+  PayloadDist payload_dist;
+  // fixed size or mean of the exponential distribution
+  size_t payload_size;
+  size_t payload_min_size;
+  size_t payload_max_size;
+  // total requests per second, 0 runs closed loop
+  double rate;
+  uint32_t duration_sec;
+  uint32_t warmup_sec;
+  // request and connect timeout
+  uint32_t timeout_ms;
+};
+
+struct LoadReport {
+  LoadReport()
+      : request_num(0),
+        error_num(0),
+        reject_num(0),
+        reconnect_num(0),
+        send_bytes(0),
+        recv_bytes(0),
+        elapsed_ns(0) {}
+
+  uint64_t request_num;
+  uint64_t error_num;
+  // answered with a non ok status such as eServerOverloaded, not part of
+  // the latency
+  uint64_t reject_num;
+  // connections lost with requests in flight
+  uint64_t reconnect_num;
+  uint64_t send_bytes;
+  uint64_t recv_bytes;
+  uint64_t elapsed_ns;
+  // ns, from the intended send time in open loop mode
+  webkit::HistogramSnapshot latency;
+};
+
+struct LoadRequest {
+  // latency is measured from the intended send time, which is the send time
+  // in closed loop mode and the schedule slot in open loop mode
+  uint64_t intended_ns;
+  uint64_t send_ns;
+};
+
+struct LoadConnection {
+  LoadConnection()
+      : is_connecting(false), connect_ns(0), send_pos(0), next_send_ns(0) {}
+
+  std::unique_ptr<webkit::TcpSocket> socket_up;
+  // the non blocking connect has not completed yet
+  bool is_connecting;
+  uint64_t connect_ns;
+  std::string send_buf;
+  size_t send_pos;
+  std::string recv_buf;
+  // requests in flight, oldest first
+  std::deque<LoadRequest> inflight_queue;
+  uint64_t next_send_ns;
+};
+
+// drives its share of the connections from one thread with poll
+class LoadWorker {
+ public:
+  LoadWorker(const LoadOption &option, uint32_t worker_idx,
+             uint32_t connection_num);
+
+  ~LoadWorker() = default;
+
+  void Run(uint64_t begin_ns, uint64_t warmup_end_ns, uint64_t end_ns);
+
+  const LoadReport &GetReport() const { return report_; }
+
+  webkit::HistogramSnapshot GetLatency() const { return latency_.Snapshot(); }
+
+ private:
+  // start a non blocking connect, false if it failed right away
+  bool Connect(LoadConnection &conn, uint64_t now_ns);
+
+  // false if the connect failed
+  bool FinishConnect(LoadConnection &conn);
+
+  void Close(LoadConnection &conn, bool is_measured);
+
+  // false if a request could not be framed
+  bool Fill(LoadConnection &conn, uint64_t now_ns);
+
+  bool Send(LoadConnection &conn, bool is_measured);
+
+  // return false once the connection broke or the peer closed it with
+  // requests still in flight
+  bool Recv(LoadConnection &conn, uint64_t now_ns, bool is_measured);
+
+  size_t NextPayloadSize();
+
+  // nullptr if serializing or framing the request failed
+  const std::string *GetFrame(size_t payload_size);
+
+  const LoadOption &option_;
+  std::vector<LoadConnection> conn_vec_;
+  std::unordered_map<size_t, std::string> frame_map_;
+  std::mt19937_64 rng_;
+  // per connection interval between intended sends in open loop mode
+  uint64_t interval_ns_;
+  LoadReport report_;
+  webkit::Histogram latency_;
+};
+
+class LoadGenerator {
+ public:
+  LoadGenerator(const LoadOption &option);
+
+  ~LoadGenerator() = default;
+
+  LoadReport Run();
+
+ private:
+  const LoadOption &option_;
+};
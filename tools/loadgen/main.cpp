@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "load_generator.h"
+#include "third_party/fmt/include/fmt/printf.h"
+
+static void PrintUsage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --ip=127.0.0.1 --port=8080     server address\n"
+          "  --threads=1                    client threads\n"
+          "  --connections=1                connections over all threads\n"
+          "  --depth=1                      requests in flight per connection\n"
+          "                                 only 1, the server closes a\n"
+          "                                 connection after one reply\n"
+          "  --method=1                     request method id\n"
+          "  --payload=fixed:64             fixed:<size>, uniform:<min>:<max>\n"
+          "                                 or exp:<mean>:<min>:<max>\n"
+          "  --rate=0                       requests per second, 0 runs\n"
+          "                                 closed loop\n"
+          "  --duration=10 --warmup=1       seconds\n"
+          "  --timeout_ms=1000              request and connect timeout, > 0\n"
+          "  --json=path                    also write the report as json\n",
+          name);
+}
+
+static bool ParsePayload(const std::string &value, LoadOption &option) {
+  unsigned long a = 0, b = 0, c = 0;
+  if (sscanf(value.c_str(), "fixed:%lu", &a) == 1) {
+    option.payload_dist = LoadOption::eFixed;
+    option.payload_size = a;
+  } else if (sscanf(value.c_str(), "uniform:%lu:%lu", &a, &b) == 2 && a <= b) {
+    option.payload_dist = LoadOption::eUniform;
+    option.payload_min_size = a;
+    option.payload_max_size = b;
+  } else if (sscanf(value.c_str(), "exp:%lu:%lu:%lu", &a, &b, &c) == 3 &&
+             a > 0 && b <= c) {
+    option.payload_dist = LoadOption::eExp;
+    option.payload_size = a;
+    option.payload_min_size = b;
+    option.payload_max_size = c;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool ParseOption(int argc, char *argv[], LoadOption &option,
+                        std::string &json_path) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *eq = strchr(arg, '=');
+    if (eq == nullptr) return false;
+    std::string key(arg, eq - arg);
+    std::string value(eq + 1);
+    if (key == "--ip") {
+      option.ip = value;
+    } else if (key == "--port") {
+      option.port = static_cast<uint16_t>(atoi(value.c_str()));
+    } else if (key == "--threads") {
+      option.thread_num = atoi(value.c_str());
+    } else if (key == "--connections") {
+      option.connection_num = atoi(value.c_str());
+    } else if (key == "--depth") {
+      option.depth = atoi(value.c_str());
+    } else if (key == "--method") {
+      option.method_id = strtoul(value.c_str(), nullptr, 10);
+    } else if (key == "--payload") {
+      if (!ParsePayload(value, option)) return false;
+    } else if (key == "--rate") {
+      option.rate = atof(value.c_str());
+    } else if (key == "--duration") {
+      option.duration_sec = atoi(value.c_str());
+    } else if (key == "--warmup") {
+      option.warmup_sec = atoi(value.c_str());
+    } else if (key == "--timeout_ms") {
+      option.timeout_ms = atoi(value.c_str());
+    } else if (key == "--json") {
+      json_path = value;
+    } else {
+      return false;
+    }
+  }
+  // ThreadServer answers one request per connection and closes it, a
+  // second request sent on it would always be counted as an error
+  return option.connection_num > 0 && option.depth == 1 &&
+         option.duration_sec > 0 && option.timeout_ms > 0;
+}
+
+static const double kQuantileArr[] = {0.5, 0.9, 0.99, 0.999, 0.9999};
+
+static std::string ToText(const LoadOption &option, const LoadReport &report) {
+  double elapsed_sec = report.elapsed_ns / 1e9;
+  std::string text = fmt::sprintf(
+      "mode %s connections %u depth %u threads %u\n",
+      option.rate > 0 ? fmt::sprintf("open loop %.0f/s", option.rate)
+                      : std::string("closed loop"),
+      option.connection_num, option.depth, option.thread_num);
+  text += fmt::sprintf(
+      "requests %lu errors %lu rejects %lu reconnects %lu in %.2fs\n",
+      report.request_num, report.error_num, report.reject_num,
+      report.reconnect_num, elapsed_sec);
+  text += fmt::sprintf("throughput %.1f req/s send %.2f MB/s recv %.2f MB/s\n",
+                       report.request_num / elapsed_sec,
+                       report.send_bytes / elapsed_sec / 1e6,
+                       report.recv_bytes / elapsed_sec / 1e6);
+  text += fmt::sprintf("latency us mean %.1f", report.latency.Mean() / 1e3);
+  for (double quantile : kQuantileArr) {
+    text += fmt::sprintf(" p%g %.1f", quantile * 100,
+                         report.latency.Percentile(quantile) / 1e3);
+  }
+  text += fmt::sprintf(" max %.1f\n", report.latency.Max() / 1e3);
+  return text;
+}
+
+static std::string ToJson(const LoadOption &option, const LoadReport &report) {
+  double elapsed_sec = report.elapsed_ns / 1e9;
+  std::string json = "{";
+  json += fmt::sprintf("\"mode\": \"%s\", ", option.rate > 0 ? "open" : "closed");
+  json += fmt::sprintf("\"rate\": %.1f, ", option.rate);
+  json += fmt::sprintf("\"connections\": %u, ", option.connection_num);
+  json += fmt::sprintf("\"depth\": %u, ", option.depth);
+  json += fmt::sprintf("\"threads\": %u, ", option.thread_num);
+  json += fmt::sprintf("\"elapsed_sec\": %.3f, ", elapsed_sec);
+  json += fmt::sprintf("\"requests\": %lu, ", report.request_num);
+  json += fmt::sprintf("\"errors\": %lu, ", report.error_num);
+  json += fmt::sprintf("\"rejects\": %lu, ", report.reject_num);
+  json += fmt::sprintf("\"reconnects\": %lu, ", report.reconnect_num);
+  json += fmt::sprintf("\"requests_per_sec\": %.1f, ",
+                       report.request_num / elapsed_sec);
+  json += fmt::sprintf("\"send_bytes\": %lu, ", report.send_bytes);
+  json += fmt::sprintf("\"recv_bytes\": %lu, ", report.recv_bytes);
+  json += "\"latency_ns\": {";
+  json += fmt::sprintf("\"mean\": %.1f, ", report.latency.Mean());
+  for (double quantile : kQuantileArr) {
+    json += fmt::sprintf("\"p%g\": %lu, ", quantile * 100,
+                         report.latency.Percentile(quantile));
+  }
+  json += fmt::sprintf("\"max\": %lu}}\n", report.latency.Max());
+  return json;
+}
+
+int main(int argc, char *argv[]) {
+  LoadOption option;
+  std::string json_path;
+  if (!ParseOption(argc, argv, option, json_path)) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+
+  LoadGenerator generator(option);
+  LoadReport report = generator.Run();
+  fputs(ToText(option, report).c_str(), stdout);
+
+  if (json_path.empty()) return 0;
+  FILE *file = fopen(json_path.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "open %s error %s\n", json_path.c_str(), strerror(errno));
+    return -1;
+  }
+  fputs(ToJson(option, report).c_str(), file);
+  fclose(file);
+  return 0;
+}
@@ -0,0 +1,191 @@
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/args.h"
+#include "third_party/fmt/include/fmt/printf.h"
+#include "webkit/binary_logger.h"
+
+using webkit::BinaryLogger;
+
+struct Site {
+  uint8_t level;
+  uint32_t line;
+  std::string file;
+  std::string func;
+  std::string format;
+};
+
+class Reader {
+ public:
+  Reader(const std::vector<char> &data) : data_(data), pos_(0) {}
+
+  bool IsEnd() const { return pos_ >= data_.size(); }
+
+  template <typename T>
+  bool Get(T &value) {
+    if (pos_ + sizeof(T) > data_.size()) return false;
+    memcpy(&value, &data_[pos_], sizeof(T));
+    pos_ += sizeof(T);
+    return true;
+  }
+
+  bool GetString(std::string &str) {
+    uint32_t len = 0;
+    if (!Get(len) || pos_ + len > data_.size()) return false;
+    str.assign(&data_[pos_], len);
+    pos_ += len;
+    return true;
+  }
+
+  bool IsMagic() const {
+    if (pos_ + sizeof(BinaryLogger::kMagic) > data_.size()) return false;
+    return memcmp(&data_[pos_], BinaryLogger::kMagic,
+                  sizeof(BinaryLogger::kMagic)) == 0;
+  }
+
+  void Skip(size_t size) { pos_ += size; }
+
+  size_t Pos() const { return pos_; }
+
+ private:
+  const std::vector<char> &data_;
+  size_t pos_;
+};
+
+static const char *LevelToString(uint8_t level) {
+  static constexpr const char *level_strings[]{"",     "Debug", "Info",
+                                               "Warn", "Error", "Fatal"};
+  if (level >= sizeof(level_strings) / sizeof(level_strings[0])) return "";
+  return level_strings[level];
+}
+
+static bool DecodeArgs(Reader &reader, uint32_t args_size,
+                       fmt::dynamic_format_arg_store<fmt::printf_context> &store) {
+  size_t end = reader.Pos() + args_size;
+  while (reader.Pos() < end) {
+    uint8_t type = 0;
+    if (!reader.Get(type)) return false;
+    switch (type) {
+      case BinaryLogger::eArgInt: {
+        int64_t value = 0;
+        if (!reader.Get(value)) return false;
+        store.push_back(value);
+        break;
+      }
+      case BinaryLogger::eArgUint: {
+        uint64_t value = 0;
+        if (!reader.Get(value)) return false;
+        store.push_back(value);
+        break;
+      }
+      case BinaryLogger::eArgDouble: {
+        double value = 0;
+        if (!reader.Get(value)) return false;
+        store.push_back(value);
+        break;
+      }
+      case BinaryLogger::eArgString: {
+        std::string value;
+        if (!reader.GetString(value)) return false;
+        store.push_back(value);
+        break;
+      }
+      case BinaryLogger::eArgPointer: {
+        uint64_t value = 0;
+        if (!reader.Get(value)) return false;
+        store.push_back(reinterpret_cast<const void *>(value));
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return reader.Pos() == end;
+}
+
+static std::string FormatTime(uint64_t timestamp_ns) {
+  time_t sec = static_cast<time_t>(timestamp_ns / 1000000000UL);
+  struct tm st_time;
+  char buf[32];
+  localtime_r(&sec, &st_time);
+  strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &st_time);
+  return fmt::sprintf("%s.%06u", buf,
+                      static_cast<uint32_t>(timestamp_ns % 1000000000UL / 1000));
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <binary log file>\n", argv[0]);
+    return -1;
+  }
+  FILE *fp = fopen(argv[1], "rb");
+  if (fp == nullptr) {
+    fprintf(stderr, "open %s error %s\n", argv[1], strerror(errno));
+    return -1;
+  }
+  std::vector<char> data;
+  char buf[1 << 16];
+  size_t nread = 0;
+  while ((nread = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    data.insert(data.end(), buf, buf + nread);
+  }
+  fclose(fp);
+
+  // every process appending to the file starts with the magic and its own
+  // site table
+  std::unordered_map<uint32_t, Site> site_map;
+  Reader reader(data);
+  while (!reader.IsEnd()) {
+    if (reader.IsMagic()) {
+      reader.Skip(sizeof(BinaryLogger::kMagic));
+      site_map.clear();
+      continue;
+    }
+    uint8_t type = 0;
+    reader.Get(type);
+    if (type == BinaryLogger::eRecordSite) {
+      uint32_t site_id = 0;
+      Site site;
+      if (!reader.Get(site_id) || !reader.Get(site.level) ||
+          !reader.Get(site.line) || !reader.GetString(site.file) ||
+          !reader.GetString(site.func) || !reader.GetString(site.format)) {
+        fprintf(stderr, "truncated site record at %zu\n", reader.Pos());
+        return -1;
+      }
+      site_map[site_id] = std::move(site);
+    } else if (type == BinaryLogger::eRecordLog) {
+      uint32_t site_id = 0;
+      uint64_t timestamp_ns = 0;
+      uint32_t args_size = 0;
+      if (!reader.Get(site_id) || !reader.Get(timestamp_ns) ||
+          !reader.Get(args_size)) {
+        fprintf(stderr, "truncated log record at %zu\n", reader.Pos());
+        return -1;
+      }
+      auto iter = site_map.find(site_id);
+      fmt::dynamic_format_arg_store<fmt::printf_context> store;
+      if (iter == site_map.end() || !DecodeArgs(reader, args_size, store)) {
+        fprintf(stderr, "bad log record at %zu\n", reader.Pos());
+        return -1;
+      }
+      const Site &site = iter->second;
+      std::string message;
+      try {
+        message = fmt::vsprintf(fmt::string_view(site.format), store);
+      } catch (const std::exception &e) {
+        message = fmt::sprintf("<format error %s> %s", e.what(), site.format);
+      }
+      printf("%s [%s] %s:%u(%s) %s\n", FormatTime(timestamp_ns).c_str(),
+             LevelToString(site.level), site.file.c_str(), site.line,
+             site.func.c_str(), message.c_str());
+    } else {
+      fprintf(stderr, "unknown record type %u at %zu\n", type, reader.Pos());
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -1,30 +1,28 @@
 #pragma once
 
 #include <atomic>
-#include <cassert>
+#include <cstdint>
+#include <utility>
 
 #include "webkit/status.h"
 
 namespace webkit {
+// bounded multi-producer multi-consumer queue, every slot carries a sequence
+// number telling whether it is ready for the producer or the consumer of the
+// current lap, so a slot is never read before its value is written
 template <typename T>
 class CircularQueue {
- protected:
-  enum class State {
-    eDefault = 0,
-    eEmpty = 1,
-    eWriting = 2,
-    eReading = 3,
-    eOk = 4,
-  };
-
  public:
   CircularQueue(size_t capacity);
 
-  virtual ~CircularQueue();
+  ~CircularQueue();
+
+  Status Push(const T &value);
 
-  virtual Status Push(const T &value);
+  // moves value in only when a slot is free, value is left as is on failure
+  Status Push(T &&value);
 
-  virtual Status Pop(T &data);
+  Status Pop(T &data);
 
   size_t Capacity() const;
 
@@ -35,72 +33,107 @@ class CircularQueue {
   bool IsEmpty() const;
 
  private:
-  State *state_buffer_;
-  T *data_buffer_;
+  struct Slot {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  // claim the slot at the tail, nullptr if the queue is full
+  Slot *AcquireTail(size_t &pos);
+
+  Slot *slot_buffer_;
   size_t capacity_;
-  std::atomic<size_t> head_;
-  std::atomic<size_t> tail_;
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
 };
 
 template <typename T>
 CircularQueue<T>::CircularQueue(size_t capacity)
-    : state_buffer_(new State[capacity]),
-      data_buffer_(new T[capacity]),
+    : slot_buffer_(new Slot[capacity]),
       capacity_(capacity),
       head_(0),
-      tail_(0) {}
+      tail_(0) {
+  for (size_t i = 0; i < capacity_; i++) {
+    slot_buffer_[i].seq.store(i, std::memory_order_relaxed);
+  }
+}
 
 template <typename T>
 CircularQueue<T>::~CircularQueue() {
-  delete[] state_buffer_;
-  delete[] data_buffer_;
+  delete[] slot_buffer_;
 }
 
 template <typename T>
-Status CircularQueue<T>::Push(const T &value) {
-  size_t idx;
+typename CircularQueue<T>::Slot *CircularQueue<T>::AcquireTail(size_t &pos) {
+  pos = tail_.load(std::memory_order_relaxed);
   while (true) {
-    idx = tail_.load(std::memory_order_acquire);
-    if (IsFull()) {
-      return Status::Error(StatusCode::eCircularQueueFull,
-                           "circular queue is full");
-    }
-    if (tail_.compare_exchange_strong(idx, (idx + 1) % capacity_,
-                                      std::memory_order_release,
-                                      std::memory_order_acquire)) {
-      idx = (idx + 1) % capacity_;
-      break;
+    Slot *slot = &slot_buffer_[pos % capacity_];
+    size_t seq = slot->seq.load(std::memory_order_acquire);
+    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (tail_.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed)) {
+        return slot;
+      }
+    } else if (diff < 0) {
+      return nullptr;
+    } else {
+      pos = tail_.load(std::memory_order_relaxed);
     }
   }
-  state_buffer_[idx] = State::eWriting;
-  assert(state_buffer_[idx] == State::eWriting);
-  data_buffer_[idx] = value;
-  assert(state_buffer_[idx] == State::eWriting);
-  state_buffer_[idx] = State::eOk;
+}
+
+template <typename T>
+Status CircularQueue<T>::Push(const T &value) {
+  size_t pos;
+  Slot *slot = AcquireTail(pos);
+  if (slot == nullptr) {
+    return Status::Error(StatusCode::eCircularQueueFull,
+                         "circular queue is full");
+  }
+  slot->data = value;
+  slot->seq.store(pos + 1, std::memory_order_release);
+  return Status::OK();
+}
+
+template <typename T>
+Status CircularQueue<T>::Push(T &&value) {
+  size_t pos;
+  Slot *slot = AcquireTail(pos);
+  if (slot == nullptr) {
+    return Status::Error(StatusCode::eCircularQueueFull,
+                         "circular queue is full");
+  }
+  slot->data = std::move(value);
+  slot->seq.store(pos + 1, std::memory_order_release);
   return Status::OK();
 }
 
 template <typename T>
 Status CircularQueue<T>::Pop(T &data) {
-  size_t idx;
+  Slot *slot;
+  size_t pos = head_.load(std::memory_order_relaxed);
   while (true) {
-    idx = head_.load(std::memory_order_acquire);
-    if (IsEmpty()) {
+    slot = &slot_buffer_[pos % capacity_];
+    size_t seq = slot->seq.load(std::memory_order_acquire);
+    intptr_t diff =
+        static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (head_.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
       return Status::Error(StatusCode::eCircularQueueEmpty,
                            "circular queue is empty");
-    }
-    if (head_.compare_exchange_strong(idx, (idx + 1) % capacity_,
-                                      std::memory_order_release,
-                                      std::memory_order_acquire)) {
-      idx = (idx + 1) % capacity_;
-      break;
+    } else {
+      pos = head_.load(std::memory_order_relaxed);
     }
   }
-  state_buffer_[idx] = State::eReading;
-  assert(state_buffer_[idx] == State::eReading);
-  data = data_buffer_[idx];
-  assert(state_buffer_[idx] == State::eReading);
-  state_buffer_[idx] = State::eEmpty;
+  data = std::move(slot->data);
+  // drop whatever the moved-from value still holds, e.g. captured pointers
+  slot->data = T();
+  slot->seq.store(pos + capacity_, std::memory_order_release);
   return Status::OK();
 }
 
@@ -113,12 +146,8 @@ template <typename T>
 size_t CircularQueue<T>::Size() const {
   size_t head = head_.load(std::memory_order_acquire);
   size_t tail = tail_.load(std::memory_order_acquire);
-  if (head < tail) return tail - head;
-  if (tail > head) return head + capacity_ - tail;
-  if (state_buffer_[tail] == State::eOk) {
-    return capacity_;
-  }
-  return 0;
+  if (tail <= head) return 0;
+  return tail - head < capacity_ ? tail - head : capacity_;
 }
 
 template <typename T>
@@ -130,4 +159,4 @@ template <typename T>
 bool CircularQueue<T>::IsEmpty() const {
   return Size() == 0;
 }
-}  // namespace webkit
\ No newline at end of file
+}  // namespace webkit
@@ -0,0 +1,118 @@
+#include "coarse_clock.h"
+
+#include <time.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace webkit {
+static constexpr size_t kSecondStrSize = 19;
+
+static void FormatSecond(uint64_t sec, char *buf) {
+  time_t timestamp = static_cast<time_t>(sec);
+  struct tm st_time;
+  memset(&st_time, 0, sizeof(st_time));
+  char tmp[32];
+  if (localtime_r(&timestamp, &st_time) == nullptr ||
+      strftime(tmp, sizeof(tmp), "%Y-%m-%d %H:%M:%S", &st_time) !=
+          kSecondStrSize) {
+    memset(buf, '0', kSecondStrSize);
+    return;
+  }
+  memcpy(buf, tmp, kSecondStrSize);
+}
+
+CoarseClock::CoarseClock()
+    : now_ms_(0), seq_(0), second_(0), ticker_ref_(0), is_ticking_(false) {
+  for (auto &word : second_str_) word.store(0, std::memory_order_relaxed);
+}
+
+CoarseClock::~CoarseClock() {
+  is_ticking_ = false;
+  if (ticker_thread_.joinable()) ticker_thread_.join();
+}
+
+void CoarseClock::Start(int interval_ms) {
+  std::lock_guard<std::mutex> lg(ticker_mutex_);
+  if (ticker_ref_++ > 0) return;
+  Tick();
+  is_ticking_ = true;
+  ticker_thread_ = std::thread([this, interval_ms] {
+    while (is_ticking_) {
+      Tick();
+      std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+  });
+}
+
+void CoarseClock::Stop() {
+  std::lock_guard<std::mutex> lg(ticker_mutex_);
+  if (ticker_ref_ == 0 || --ticker_ref_ > 0) return;
+  is_ticking_ = false;
+  ticker_thread_.join();
+}
+
+void CoarseClock::Tick() {
+  uint64_t now_ms = RealNowMs();
+  now_ms_.store(now_ms, std::memory_order_release);
+  uint64_t sec = now_ms / 1000;
+  if (second_.load(std::memory_order_acquire) != sec) UpdateSecond(sec);
+}
+
+uint64_t CoarseClock::NowMs() const {
+  if (!is_ticking_.load(std::memory_order_acquire)) return RealNowMs();
+  return now_ms_.load(std::memory_order_acquire);
+}
+
+size_t CoarseClock::FormatNow(char *buf, size_t size) const {
+  if (size < kTimeStrSize) return 0;
+  uint64_t now_ms = NowMs();
+  uint64_t sec = now_ms / 1000;
+  if (!ReadSecond(sec, buf)) FormatSecond(sec, buf);
+  uint32_t ms = static_cast<uint32_t>(now_ms % 1000);
+  buf[kSecondStrSize] = '.';
+  buf[kSecondStrSize + 1] = static_cast<char>('0' + ms / 100);
+  buf[kSecondStrSize + 2] = static_cast<char>('0' + ms / 10 % 10);
+  buf[kSecondStrSize + 3] = static_cast<char>('0' + ms % 10);
+  return kTimeStrSize;
+}
+
+uint64_t CoarseClock::RealNowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000 +
+         static_cast<uint64_t>(ts.tv_nsec) / 1000000;
+}
+
+void CoarseClock::UpdateSecond(uint64_t sec) {
+  std::unique_lock<std::mutex> ul(update_mutex_, std::try_to_lock);
+  if (!ul.owns_lock()) return;
+  if (second_.load(std::memory_order_relaxed) >= sec) return;
+
+  uint64_t words[kWordNum] = {0};
+  FormatSecond(sec, reinterpret_cast<char *>(words));
+
+  uint32_t seq = seq_.load(std::memory_order_relaxed);
+  seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < kWordNum; i++) {
+    second_str_[i].store(words[i], std::memory_order_relaxed);
+  }
+  second_.store(sec, std::memory_order_relaxed);
+  seq_.store(seq + 2, std::memory_order_release);
+}
+
+bool CoarseClock::ReadSecond(uint64_t sec, char *buf) const {
+  uint64_t words[kWordNum];
+  uint32_t seq = seq_.load(std::memory_order_acquire);
+  if (seq & 1) return false;
+  if (second_.load(std::memory_order_relaxed) != sec) return false;
+  for (size_t i = 0; i < kWordNum; i++) {
+    words[i] = second_str_[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (seq_.load(std::memory_order_relaxed) != seq) return false;
+  memcpy(buf, words, kSecondStrSize);
+  return true;
+}
+}  // namespace webkit
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace webkit {
+// process wide clock refreshed by a ticker thread and by reactor loops,
+// readers get the time and a pre-formatted second string without syscalls
+class CoarseClock {
+ private:
+  CoarseClock();
+
+ public:
+  // "YYYY-mm-dd HH:MM:SS.mmm"
+  static constexpr size_t kTimeStrSize = 23;
+
+  ~CoarseClock();
+
+  static CoarseClock *GetInstance() {
+    static CoarseClock instance;
+    return &instance;
+  }
+
+  // start the ticker, nested Start/Stop pairs share one thread, it only
+  // bounds the staleness of idle readers, threads that need a fresher time,
+  // like reactor loops after each wait, call Tick themselves
+  void Start(int interval_ms = 10);
+
+  void Stop();
+
+  void Tick();
+
+  uint64_t NowMs() const;
+
+  // write the current time into buf without the trailing '\0',
+  // return the written size or 0 if size is less than kTimeStrSize
+  size_t FormatNow(char *buf, size_t size) const;
+
+  static uint64_t RealNowMs();
+
+ private:
+  static constexpr size_t kWordNum = 3;
+
+  void UpdateSecond(uint64_t sec);
+
+  bool ReadSecond(uint64_t sec, char *buf) const;
+
+  std::atomic<uint64_t> now_ms_;
+
+  // seqlock protected pre-formatted "YYYY-mm-dd HH:MM:SS" for second_
+  std::atomic<uint32_t> seq_;
+  std::atomic<uint64_t> second_;
+  std::atomic<uint64_t> second_str_[kWordNum];
+  std::mutex update_mutex_;
+
+  std::mutex ticker_mutex_;
+  int ticker_ref_;
+  std::atomic<bool> is_ticking_;
+  std::thread ticker_thread_;
+};
+}  // namespace webkit
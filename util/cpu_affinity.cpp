@@ -0,0 +1,101 @@
+#include "cpu_affinity.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace webkit {
+static const char *kNumaNodePath = "/sys/devices/system/node";
+
+Status CpuAffinity::ParseCpuList(const std::string &cpu_list,
+                                 std::vector<uint32_t> &cpu_vec) {
+  cpu_vec.clear();
+  size_t pos = 0;
+  while (pos < cpu_list.size()) {
+    size_t end = cpu_list.find(',', pos);
+    if (end == std::string::npos) end = cpu_list.size();
+    std::string range = cpu_list.substr(pos, end - pos);
+    pos = end + 1;
+    if (range.empty() || range == "\n") continue;
+
+    char *range_end = nullptr;
+    unsigned long first = strtoul(range.c_str(), &range_end, 10);
+    unsigned long last = first;
+    if (*range_end == '-') last = strtoul(range_end + 1, &range_end, 10);
+    bool is_end = *range_end == '\0' || *range_end == '\n';
+    if (range_end == range.c_str() || !is_end || last < first ||
+        last >= CPU_SETSIZE) {
+      return Status::ErrorF(StatusCode::eParamError, "invalid cpu list %s",
+                            cpu_list);
+    }
+    for (unsigned long cpu = first; cpu <= last; cpu++) {
+      cpu_vec.push_back(static_cast<uint32_t>(cpu));
+    }
+  }
+  return Status::OK();
+}
+
+Status CpuAffinity::PinThread(const std::vector<uint32_t> &cpu_vec) {
+  if (cpu_vec.empty()) return Status::OK();
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (uint32_t cpu : cpu_vec) {
+    if (cpu >= CPU_SETSIZE) {
+      return Status::ErrorF(StatusCode::eParamError, "invalid cpu %u", cpu);
+    }
+    CPU_SET(cpu, &cpu_set);
+  }
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (ret != 0) {
+    return Status::ErrorF(StatusCode::eAffinityError,
+                          "pthread_setaffinity_np error %d %s", ret,
+                          strerror(ret));
+  }
+  return Status::OK();
+}
+
+uint32_t CpuAffinity::GetNumaNodeNum() {
+  uint32_t node_num = 0;
+  while (true) {
+    std::ifstream file(fmt::sprintf("%s/node%u/cpulist", kNumaNodePath,
+                                    node_num));
+    if (!file.is_open()) break;
+    node_num++;
+  }
+  return node_num == 0 ? 1 : node_num;
+}
+
+Status CpuAffinity::GetNumaNodeCpuVec(uint32_t node,
+                                      std::vector<uint32_t> &cpu_vec) {
+  std::ifstream file(fmt::sprintf("%s/node%u/cpulist", kNumaNodePath, node));
+  if (!file.is_open()) {
+    if (node != 0) {
+      return Status::ErrorF(StatusCode::eParamError, "numa node %u not found",
+                            node);
+    }
+    cpu_vec.clear();
+    long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+    for (long cpu = 0; cpu < cpu_num; cpu++) cpu_vec.push_back(cpu);
+    return Status::OK();
+  }
+  std::string cpu_list;
+  std::getline(file, cpu_list);
+  return ParseCpuList(cpu_list, cpu_vec);
+}
+
+Status CpuAffinity::RunOn(const std::vector<uint32_t> &cpu_vec,
+                          const std::function<void()> &func) {
+  Status s;
+  std::thread thread([&] {
+    s = PinThread(cpu_vec);
+    func();
+  });
+  thread.join();
+  return s;
+}
+}  // namespace webkit
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "webkit/status.h"
+
+namespace webkit {
+class CpuAffinity {
+ public:
+  // "0-3,8,10-11" as in /sys/devices/system/node/node*/cpulist
+  static Status ParseCpuList(const std::string &cpu_list,
+                             std::vector<uint32_t> &cpu_vec);
+
+  // restrict the calling thread to cpu_vec, an empty cpu_vec is a no-op
+  static Status PinThread(const std::vector<uint32_t> &cpu_vec);
+
+  // 1 when the kernel exposes no numa topology
+  static uint32_t GetNumaNodeNum();
+
+  // every cpu when the kernel exposes no numa topology
+  static Status GetNumaNodeCpuVec(uint32_t node,
+                                  std::vector<uint32_t> &cpu_vec);
+
+  // run func on a short lived thread pinned to cpu_vec, memory func touches
+  // first is then placed on the node of cpu_vec by the kernel
+  static Status RunOn(const std::vector<uint32_t> &cpu_vec,
+                      const std::function<void()> &func);
+};
+}  // namespace webkit
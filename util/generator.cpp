@@ -0,0 +1,115 @@
+#include "generator.h"
+
+#include <unistd.h>
+
+#include "util/coarse_clock.h"
+
+namespace webkit {
+static constexpr uint32_t kSlotNum = 1U << UidGenerator::kThreadBits;
+static constexpr uint32_t kSharedSlot = kSlotNum - 1;
+static constexpr uint32_t kMaxSequence = (1U << UidGenerator::kSequenceBits) - 1;
+
+static std::atomic<uint32_t> UsedSlotMask{0};
+// last millisecond used by the previous owner of each slot, a new owner
+// continues after it so borrowed milliseconds are never handed out twice
+static std::atomic<uint64_t> SlotLastMsArr[kSlotNum];
+
+// exclusive slot of the calling thread, given back when the thread exits
+class UidThreadState {
+ public:
+  UidThreadState() : slot_(kSharedSlot), last_ms_(0), sequence_(0) {
+    uint32_t mask = UsedSlotMask.load(std::memory_order_relaxed);
+    while (true) {
+      uint32_t slot = __builtin_ctz(~mask);
+      if (slot >= kSharedSlot) break;
+      if (UsedSlotMask.compare_exchange_weak(mask, mask | (1U << slot),
+                                             std::memory_order_relaxed)) {
+        slot_ = slot;
+        last_ms_ = SlotLastMsArr[slot].load(std::memory_order_relaxed);
+        sequence_ = kMaxSequence;
+        break;
+      }
+    }
+  }
+
+  ~UidThreadState() {
+    if (slot_ == kSharedSlot) return;
+    SlotLastMsArr[slot_].store(last_ms_, std::memory_order_relaxed);
+    UsedSlotMask.fetch_and(~(1U << slot_), std::memory_order_relaxed);
+  }
+
+  uint32_t slot_;
+  uint64_t last_ms_;
+  uint32_t sequence_;
+};
+
+void UidGenerator::Init(const std::string &ip) {
+  // fnv-1a of ip and pid folded into the host bits
+  uint32_t hash = 2166136261U;
+  auto mix = [&hash](uint8_t byte) {
+    hash ^= byte;
+    hash *= 16777619U;
+  };
+  for (char c : ip) mix(static_cast<uint8_t>(c));
+  uint32_t pid = static_cast<uint32_t>(getpid());
+  for (uint32_t i = 0; i < sizeof(pid); i++) mix(pid >> (8 * i));
+  SetHostId(hash ^ (hash >> kHostBits) ^ (hash >> (2 * kHostBits)));
+}
+
+uint64_t UidGenerator::Generate() {
+  static thread_local UidThreadState state;
+  uint64_t now_ms = CoarseClock::GetInstance()->NowMs() - kEpochMs;
+  if (state.slot_ == kSharedSlot) return GenerateShared(now_ms);
+
+  // when the sequence runs out or the clock steps back, borrow the next
+  // millisecond instead of waiting, ids stay unique and increasing
+  if (now_ms > state.last_ms_) {
+    state.last_ms_ = now_ms;
+    state.sequence_ = 0;
+  } else if (++state.sequence_ > kMaxSequence) {
+    state.last_ms_++;
+    state.sequence_ = 0;
+  }
+  return Pack(state.last_ms_, state.slot_, state.sequence_);
+}
+
+uint64_t UidGenerator::GenerateShared(uint64_t now_ms) {
+  uint64_t state = shared_state_.load(std::memory_order_relaxed);
+  uint64_t next;
+  do {
+    uint64_t last_ms = state >> kSequenceBits;
+    uint64_t sequence = state & kMaxSequence;
+    if (now_ms > last_ms) {
+      next = now_ms << kSequenceBits;
+    } else if (sequence < kMaxSequence) {
+      next = state + 1;
+    } else {
+      next = (last_ms + 1) << kSequenceBits;
+    }
+  } while (!shared_state_.compare_exchange_weak(state, next,
+                                                std::memory_order_relaxed));
+  return Pack(next >> kSequenceBits, kSharedSlot, next & kMaxSequence);
+}
+
+uint64_t UidGenerator::Pack(uint64_t timestamp_ms, uint32_t slot,
+                            uint32_t sequence) const {
+  return (timestamp_ms << (kHostBits + kThreadBits + kSequenceBits)) |
+         (static_cast<uint64_t>(host_id_) << (kThreadBits + kSequenceBits)) |
+         (static_cast<uint64_t>(slot) << kSequenceBits) | sequence;
+}
+
+size_t UidGenerator::ToHex(uint64_t id, char *buf, size_t size) {
+  static constexpr char kHexDigit[] = "0123456789abcdef";
+  if (size < kHexSize) return 0;
+  for (size_t i = 0; i < kHexSize; i++) {
+    buf[kHexSize - 1 - i] = kHexDigit[id & 0xF];
+    id >>= 4;
+  }
+  return kHexSize;
+}
+
+std::string UidGenerator::ToHexString(uint64_t id) {
+  char buf[kHexSize];
+  return std::string(buf, ToHex(id, buf, sizeof(buf)));
+}
+}  // namespace webkit
@@ -1,18 +1,35 @@
 #pragma once
 
-#include <cstring>
-#include <ctime>
-#include <random>
+#include <atomic>
+#include <cstdint>
 #include <string>
 
-#include "third_party/fmt/include/fmt/printf.h"
-
 namespace webkit {
+// snowflake style 64-bit ids, from the high bits:
+//   41 bits milliseconds since kEpochMs, about 69 years
+//   10 bits host id
+//    5 bits thread slot
+//    8 bits sequence within the millisecond
+// every generating thread owns a slot and its own sequence, so Generate is
+// lock-free and never touches shared cache lines; threads beyond the
+// exclusive slots share the last slot through an atomic sequence
+//
+// ids are unique among processes with distinct host ids, two processes with
+// the same host id generating in the same millisecond collide
 class UidGenerator {
  private:
-  UidGenerator() : host_id_(0) {}
+  UidGenerator() : host_id_(0), shared_state_(0) { Init(""); }
 
  public:
+  static constexpr uint32_t kTimestampBits = 41;
+  static constexpr uint32_t kHostBits = 10;
+  static constexpr uint32_t kThreadBits = 5;
+  static constexpr uint32_t kSequenceBits = 8;
+  static constexpr uint32_t kHostIdMask = (1U << kHostBits) - 1;
+  // 2020-01-01 00:00:00 UTC
+  static constexpr uint64_t kEpochMs = 1577836800000UL;
+  static constexpr size_t kHexSize = 16;
+
   ~UidGenerator() = default;
 
   static UidGenerator *GetInstance() {
@@ -20,29 +37,35 @@ class UidGenerator {
     return &instance;
   }
 
-  void Init(const std::string &ip) {
-    size_t len = ip.length();
-    size_t buf_len = (len - 1) / 16 * 16;
-    char *buf = new char[buf_len];
-    memset(buf, 0, buf_len);
-    memcpy(buf, ip.data(), ip.length());
-    for (size_t seg = 0; seg * 16 < buf_len; seg++) {
-      const uint32_t *u32_ptr = reinterpret_cast<uint32_t *>(buf) + seg;
-      host_id_ ^= *u32_ptr;
-    }
-  }
+  // derive the host id from the local ip and the pid, so processes on one
+  // host differ too, a hash folded into 10 bits is only unique by chance,
+  // about even odds of a collision among 40 processes, SetHostId with ids
+  // handed out per process where they must never collide
+  void Init(const std::string &ip);
+
+  void SetHostId(uint32_t host_id) { host_id_ = host_id & kHostIdMask; }
+
+  uint32_t GetHostId() const { return host_id_; }
 
-  std::string Generate() const {
-    static thread_local std::mt19937 rng(
-        static_cast<uint32_t>(std::time(nullptr)));
-    std::uniform_int_distribution distrib(0U,
-                                          std::numeric_limits<uint32_t>::max());
-    std::time_t now_time = std::time(nullptr);
-    uint32_t random = distrib(rng) & 0xFFFF;
-    return fmt::sprintf("%010d%05u%05u", now_time, host_id_, random);
+  uint64_t Generate();
+
+  // write id as kHexSize lower case hex digits without the trailing '\0',
+  // return the written size or 0 if size is less than kHexSize
+  static size_t ToHex(uint64_t id, char *buf, size_t size);
+
+  static std::string ToHexString(uint64_t id);
+
+  static uint64_t GetTimestampMs(uint64_t id) {
+    return (id >> (kHostBits + kThreadBits + kSequenceBits)) + kEpochMs;
   }
 
  private:
+  uint64_t Pack(uint64_t timestamp_ms, uint32_t slot, uint32_t sequence) const;
+
+  uint64_t GenerateShared(uint64_t now_ms);
+
   uint32_t host_id_;
+  // (timestamp_ms << kSequenceBits) | sequence of the shared slot
+  std::atomic<uint64_t> shared_state_;
 };
-}  // namespace webkit
\ No newline at end of file
+}  // namespace webkit
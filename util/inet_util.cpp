@@ -1,5 +1,7 @@
 #include "inet_util.h"
 
+#include <cstring>
+
 namespace webkit {
 template <>
 Status InetUtil::InetNtop<struct in_addr>(struct in_addr st_addr,
@@ -43,4 +45,16 @@ Status InetUtil::MakeSockAddr<struct sockaddr_in>(const std::string &ip,
   if (!s.Ok()) return s;
   return Status::OK();
 }
+
+Status InetUtil::MakeUnixAddr(const std::string &path,
+                              struct sockaddr_un *p_sun) {
+  memset(p_sun, 0, sizeof(struct sockaddr_un));
+  p_sun->sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(p_sun->sun_path)) {
+    return Status::ErrorF(StatusCode::eParamError, "invalid unix path %s",
+                          path);
+  }
+  memcpy(p_sun->sun_path, path.data(), path.size());
+  return Status::OK();
+}
 }  // namespace webkit
\ No newline at end of file
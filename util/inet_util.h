@@ -3,6 +3,7 @@
 #include <arpa/inet.h>
 #include <endian.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 #include <string>
 #include <type_traits>
@@ -26,6 +27,10 @@ class InetUtil {
 
   template <typename T>
   static Status MakeSockAddr(const std::string &ip, uint16_t port, T *p_sin);
+
+  // eParamError when path does not fit sun_path
+  static Status MakeUnixAddr(const std::string &path,
+                             struct sockaddr_un *p_sun);
 };
 
 template <>
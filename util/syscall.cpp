@@ -3,7 +3,11 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <sys/socket.h>
 #include <syslog.h>
+#include <unistd.h>
+
+#include <cstring>
 
 #include "webkit/logger.h"
 
@@ -79,4 +83,83 @@ Status Syscall::SetNonBlock(int fd) {
   }
   return Status::OK();
 }
-}  // namespace webkit
\ No newline at end of file
+
+// at most this many descriptors go in one message, enough for every
+// listener of a server
+static constexpr size_t kMaxPassFdNum = 64;
+
+Status Syscall::SendFdVec(int sock_fd, const std::vector<int> &fd_vec) {
+  if (fd_vec.empty() || fd_vec.size() > kMaxPassFdNum) {
+    return Status::ErrorF(StatusCode::eParamError, "invalid fd num %zu",
+                          fd_vec.size());
+  }
+  // the payload carries the count, a message with control data must also
+  // carry at least one byte
+  uint32_t fd_num = fd_vec.size();
+  struct iovec iov;
+  iov.iov_base = &fd_num;
+  iov.iov_len = sizeof(fd_num);
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) *
+                                                  kMaxPassFdNum)];
+  memset(control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_vec.size());
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_vec.size());
+  memcpy(CMSG_DATA(cmsg), fd_vec.data(), sizeof(int) * fd_vec.size());
+
+  if (sendmsg(sock_fd, &msg, MSG_NOSIGNAL) < 0) {
+    WEBKIT_LOGERROR("sendmsg fd error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eFdPassError, "send fd error");
+  }
+  return Status::OK();
+}
+
+Status Syscall::RecvFdVec(int sock_fd, std::vector<int> &fd_vec) {
+  uint32_t fd_num = 0;
+  struct iovec iov;
+  iov.iov_base = &fd_num;
+  iov.iov_len = sizeof(fd_num);
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) *
+                                                  kMaxPassFdNum)];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t ret = recvmsg(sock_fd, &msg, MSG_CMSG_CLOEXEC);
+  if (ret != sizeof(fd_num)) {
+    WEBKIT_LOGERROR("recvmsg fd error %d %s", errno, strerror(errno));
+    return Status::Error(StatusCode::eFdPassError, "recv fd error");
+  }
+  fd_vec.clear();
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    size_t num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const unsigned char *data = CMSG_DATA(cmsg);
+    for (size_t i = 0; i < num; i++) {
+      int fd;
+      memcpy(&fd, data + i * sizeof(int), sizeof(int));
+      fd_vec.push_back(fd);
+    }
+  }
+  if ((msg.msg_flags & MSG_CTRUNC) || fd_vec.size() != fd_num) {
+    for (int fd : fd_vec) close(fd);
+    fd_vec.clear();
+    return Status::ErrorF(StatusCode::eFdPassError,
+                          "recv fd num mismatch expect %u", fd_num);
+  }
+  return Status::OK();
+}
+}  // namespace webkit
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "webkit/status.h"
 
 namespace webkit {
@@ -13,5 +15,11 @@ class Syscall {
   static Status Deamon();
 
   static Status SetNonBlock(int fd);
+
+  // pass fd_vec over the unix socket sock_fd as SCM_RIGHTS, the receiver
+  // gets its own descriptors for the same open files
+  static Status SendFdVec(int sock_fd, const std::vector<int> &fd_vec);
+
+  static Status RecvFdVec(int sock_fd, std::vector<int> &fd_vec);
 };
 }  // namespace webkit
\ No newline at end of file
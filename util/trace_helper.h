@@ -1,13 +1,34 @@
 #pragma once
 
-#include <mutex>
+#include <cstdint>
+#include <type_traits>
 
-#include "webkit/status.h"
+#include "util/coarse_clock.h"
+#include "util/generator.h"
 
 namespace webkit {
+// fixed size so it can be copied between threads and into frame metadata
+// without allocating, ids are UidGenerator ids and 0 means unset
+struct TraceContext {
+  enum Flag : uint8_t {
+    eFlagSampled = 1,
+  };
+
+  uint64_t trace_id;
+  uint64_t span_id;
+  uint64_t parent_id;
+  uint8_t flags;
+
+  bool IsValid() const { return trace_id != 0; }
+
+  bool IsSampled() const { return flags & eFlagSampled; }
+};
+
+static_assert(std::is_trivially_copyable_v<TraceContext>);
+
 class TraceHelper {
  public:
-  TraceHelper() = default;
+  TraceHelper() : context_{}, deadline_ms_(0), recv_ms_(0) {}
 
   ~TraceHelper() = default;
 
@@ -16,13 +37,82 @@ class TraceHelper {
     return &instance;
   }
 
-  void SetTraceId(const std::string &trace_id) { trace_id_ = trace_id; }
+  void SetContext(const TraceContext &context) { context_ = context; }
+
+  const TraceContext &GetContext() const { return context_; }
+
+  void Clear() {
+    context_ = TraceContext{};
+    deadline_ms_ = 0;
+  }
+
+  uint64_t GetTraceId() const { return context_.trace_id; }
+
+  // absolute CoarseClock ms the current request must be answered by, 0 means
+  // no deadline, outgoing requests made while serving it inherit it
+  void SetDeadlineMs(uint64_t deadline_ms) { deadline_ms_ = deadline_ms; }
+
+  uint64_t GetDeadlineMs() const { return deadline_ms_; }
+
+  bool IsDeadlineExceeded() const {
+    return deadline_ms_ != 0 &&
+           CoarseClock::GetInstance()->NowMs() >= deadline_ms_;
+  }
+
+  // CoarseClock ms the request being served was received, 0 if unknown,
+  // set around a dispatch by its caller and kept by Clear, which the
+  // dispatcher runs first
+  void SetRecvMs(uint64_t recv_ms) { recv_ms_ = recv_ms; }
+
+  uint64_t GetRecvMs() const { return recv_ms_; }
 
-  std::string GetTraceId() { return trace_id_; }
+  // clocks of two hosts differ, so requests carry the ms left instead of
+  // the deadline, 0 if there is none, at least 1 once it has passed
+  uint64_t GetTimeoutMs() const {
+    if (deadline_ms_ == 0) return 0;
+    uint64_t now_ms = CoarseClock::GetInstance()->NowMs();
+    return deadline_ms_ > now_ms ? deadline_ms_ - now_ms : 1;
+  }
 
-  void ClearTraceId() { trace_id_.clear(); }
+  // local deadline of a request received with timeout_ms left, counted from
+  // when it was received, or from now if that is unknown
+  void SetTimeoutMs(uint64_t timeout_ms) {
+    if (timeout_ms == 0) {
+      deadline_ms_ = 0;
+      return;
+    }
+    uint64_t recv_ms =
+        recv_ms_ != 0 ? recv_ms_ : CoarseClock::GetInstance()->NowMs();
+    deadline_ms_ = recv_ms + timeout_ms;
+  }
+
+  // begin a new trace with a root span on the calling thread
+  const TraceContext &StartTrace(bool is_sampled = true) {
+    UidGenerator *generator = UidGenerator::GetInstance();
+    context_.trace_id = generator->Generate();
+    context_.span_id = generator->Generate();
+    context_.parent_id = 0;
+    context_.flags = is_sampled ? TraceContext::eFlagSampled : 0;
+    return context_;
+  }
+
+  // continue the trace of parent in a new child span, an invalid parent
+  // just clears the context
+  const TraceContext &StartSpan(const TraceContext &parent) {
+    if (!parent.IsValid()) {
+      Clear();
+      return context_;
+    }
+    context_.trace_id = parent.trace_id;
+    context_.span_id = UidGenerator::GetInstance()->Generate();
+    context_.parent_id = parent.span_id;
+    context_.flags = parent.flags;
+    return context_;
+  }
 
  private:
-  std::string trace_id_;
+  TraceContext context_;
+  uint64_t deadline_ms_;
+  uint64_t recv_ms_;
 };
-}  // namespace webkit
\ No newline at end of file
+}  // namespace webkit
@@ -0,0 +1,39 @@
+#include "tsc_clock.h"
+
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace webkit {
+static bool HasInvariantTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0) return false;
+  if (eax < 0x80000007) return false;
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1U << 8)) != 0;
+#else
+  return false;
+#endif
+}
+
+TscClock::TscClock() : is_tsc_(false), ns_per_tick_(1.0) {
+  if (!HasInvariantTsc()) return;
+#if defined(__x86_64__) || defined(__i386__)
+  // calibrate against the monotonic clock once, 10ms keeps the error well
+  // below the histogram bucket width
+  uint64_t begin_ns = MonotonicNs();
+  uint64_t begin_tick = __rdtsc();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  uint64_t end_ns = MonotonicNs();
+  uint64_t end_tick = __rdtsc();
+  if (end_tick <= begin_tick) return;
+  ns_per_tick_ =
+      static_cast<double>(end_ns - begin_ns) / (end_tick - begin_tick);
+  is_tsc_ = true;
+#endif
+}
+}  // namespace webkit
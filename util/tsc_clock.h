@@ -0,0 +1,50 @@
+#pragma once
+
+#include <time.h>
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace webkit {
+// cheap monotonic ticks for stage stamps, reads the invariant tsc when the
+// cpu has one and falls back to clock_gettime otherwise
+class TscClock {
+ private:
+  TscClock();
+
+ public:
+  ~TscClock() = default;
+
+  static TscClock *GetInstance() {
+    static TscClock instance;
+    return &instance;
+  }
+
+  uint64_t Now() const {
+#if defined(__x86_64__) || defined(__i386__)
+    if (is_tsc_) return __rdtsc();
+#endif
+    return MonotonicNs();
+  }
+
+  uint64_t ToNs(uint64_t ticks) const {
+    return static_cast<uint64_t>(ticks * ns_per_tick_);
+  }
+
+  bool IsTsc() const { return is_tsc_; }
+
+  static uint64_t MonotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000UL +
+           static_cast<uint64_t>(ts.tv_nsec);
+  }
+
+ private:
+  bool is_tsc_;
+  double ns_per_tick_;
+};
+}  // namespace webkit